@@ -38,6 +38,18 @@ def cli() -> None:
                     'help': '🌱 Name of the default branch (default: "main")',
                     'default': 'main',
                 },
+                'compress': {
+                    'type': None,
+                    'help': '🗜️ Store file contents Huffman-compressed',
+                    'default': False,
+                    'flag': True,
+                    'short_flag': 'c',
+                },
+                'hash_algorithm': {
+                    'type': str,
+                    'help': '🔑 Hash algorithm naming the objects: sha1, sha256 or blake3',
+                    'default': 'sha1',
+                },
             },
             'help': '🛠️ Initialize a new CAF repository',
         },
@@ -152,6 +164,14 @@ def cli() -> None:
             },
             'help': '📊 Display differences between two commits',
         },
+
+        'repack': {
+            'func': cli_commands.repack,
+            'args': {
+                **_repo_args,
+            },
+            'help': '📦 Move all objects into a single pack',
+        },
     }
 
     # Register commands
@@ -5,7 +5,8 @@ from collections.abc import MutableSequence, Sequence
 from datetime import datetime
 from pathlib import Path
 
-from libcaf.constants import DEFAULT_BRANCH
+from libcaf import HashAlgorithm
+from libcaf.constants import DEFAULT_BRANCH, DEFAULT_HASH_ALGORITHM
 from libcaf.plumbing import hash_file as plumbing_hash_file
 from libcaf.ref import SymRef
 from libcaf.repository import (AddedDiff, Diff, ModifiedDiff, MovedToDiff, RemovedDiff, Repository, RepositoryError,
@@ -23,9 +24,16 @@ def _print_success(message: str) -> None:
 def init(**kwargs) -> int:
     repo = _repo_from_cli_kwargs(kwargs)
     default_branch = kwargs.get('default_branch', DEFAULT_BRANCH)
+    compress = kwargs.get('compress', False)
+    hash_algorithm_name = kwargs.get('hash_algorithm', DEFAULT_HASH_ALGORITHM.name.lower())
+
+    hash_algorithm = HashAlgorithm.__members__.get(hash_algorithm_name.upper())
+    if hash_algorithm is None:
+        _print_error(f'Unknown hash algorithm {hash_algorithm_name}')
+        return -1
 
     try:
-        repo.init(default_branch)
+        repo.init(default_branch, compress, hash_algorithm)
         _print_success(f'Initialized empty CAF repository in {repo.repo_path()} on branch {default_branch}')
         return 0
     except FileExistsError:
@@ -52,17 +60,22 @@ def hash_file(**kwargs) -> int:
         _print_error(f'File {path} does not exist.')
         return -1
 
-    file_hash = plumbing_hash_file(path)
+    # hash with the algorithm of the repository the file would be saved to
+    repo = _repo_from_cli_kwargs(kwargs)
+    hash_algorithm = repo.hash_algorithm() if repo.exists() else DEFAULT_HASH_ALGORITHM
+
+    file_hash = plumbing_hash_file(path, hash_algorithm)
     _print_success(f'Hash: {file_hash}')
 
     if not kwargs.get('write', False):
         return 0
 
-    repo = _repo_from_cli_kwargs(kwargs)
-
     try:
-        repo.save_file_content(path)
-        _print_success(f'Saved file {path} to CAF repository')
+        blob = repo.save_file_content(path)
+        if blob.created:
+            _print_success(f'Saved file {path} to CAF repository')
+        else:
+            _print_success(f'File {path} is already in CAF repository')
         return 0
     except RepositoryNotFoundError:
         _print_error(f'No repository found at {repo.repo_path()}')
@@ -245,6 +258,18 @@ def diff(**kwargs) -> int:
         return -1
 
 
+def repack(**kwargs) -> int:
+    repo = _repo_from_cli_kwargs(kwargs)
+
+    try:
+        num_objects = repo.repack()
+        _print_success(f'Packed {num_objects} objects.')
+        return 0
+    except RepositoryNotFoundError:
+        _print_error(f'No repository found at {repo.repo_path()}')
+        return -1
+
+
 def _repo_from_cli_kwargs(kwargs: dict[str, str]) -> Repository:
     working_dir_path = kwargs.get('working_dir_path', '.')
     repo_dir = kwargs.get('repo_dir')
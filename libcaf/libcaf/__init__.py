@@ -1,16 +1,29 @@
 """libcaf - Content Addressable File system in Python."""
 
-from _libcaf import Blob, Commit, HuffmanNode, Tree, TreeRecord, TreeRecordType
+from _libcaf import Blob, Commit, CopyMethod, HashAlgorithm, HuffmanNode, SavedBlob, Tree, TreeRecord, TreeRecordType
+from _libcaf import LruCacheStats, ObjectCacheStats, DEFAULT_OBJECT_CACHE_SIZE
 from _libcaf import histogram, histogram_parallel, histogram_parallel_64bit, histogram_fast, huffman_tree, huffman_dict
+from _libcaf import histogram_subtables
+from _libcaf import huffman_code_lengths, reconstruct_canonical_dict
 from _libcaf import huffman_encode_span, huffman_encode_span_parallel, huffman_encode_span_parallel_twopass
-from _libcaf import canonicalize_huffman_dict, next_canonical_huffman_code, HUFFMAN_HEADER_SIZE
-from _libcaf import huffman_build_reverse_dict, huffman_decode_span, MAX_CODE_LEN
+from _libcaf import huffman_encode_span_64bit
+from _libcaf import canonicalize_huffman_dict, next_canonical_huffman_code, HUFFMAN_HEADER_SIZE, HUFFMAN_STORED_HEADER_SIZE
+from _libcaf import huffman_build_reverse_dict, huffman_decode_span, huffman_decode_span_multisymbol, MAX_CODE_LEN
 from _libcaf import calculate_compressed_size_in_bits, BitReader
-from _libcaf import huffman_encode_file, huffman_decode_file
+from _libcaf import huffman_encode_file, huffman_encode_file_indexed, huffman_encode_file_multistream, huffman_decode_file
+from _libcaf import huffman_encode_stream, huffman_decode_stream, huffman_encode_file_adaptive, huffman_encode_file_compact
+from _libcaf import HUFFMAN_DEFAULT_INDEX_INTERVAL, HUFFMAN_DEFAULT_NUM_STREAMS, HUFFMAN_DEFAULT_BLOCK_SIZE
+from _libcaf import HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE
 
 __all__ = [
     'Blob',
     'Commit',
+    'CopyMethod',
+    'HashAlgorithm',
+    'LruCacheStats',
+    'ObjectCacheStats',
+    'DEFAULT_OBJECT_CACHE_SIZE',
+    'SavedBlob',
     'Tree',
     'TreeRecord',
     'TreeRecordType',
@@ -19,19 +32,35 @@ __all__ = [
     'histogram_parallel_64bit',
     'histogram_fast',
     'HuffmanNode',
+    'histogram_subtables',
     'huffman_tree',
     'huffman_dict',
+    'huffman_code_lengths',
+    'reconstruct_canonical_dict',
     'huffman_encode_span',
     'huffman_encode_span_parallel',
     'huffman_encode_span_parallel_twopass',
+    'huffman_encode_span_64bit',
     'canonicalize_huffman_dict',
     'next_canonical_huffman_code',
     'HUFFMAN_HEADER_SIZE',
+    'HUFFMAN_STORED_HEADER_SIZE',
     'huffman_build_reverse_dict',
     'huffman_decode_span',
+    'huffman_decode_span_multisymbol',
     'MAX_CODE_LEN',
     'calculate_compressed_size_in_bits',
     'BitReader',
     'huffman_encode_file',
+    'huffman_encode_file_indexed',
+    'HUFFMAN_DEFAULT_INDEX_INTERVAL',
+    'huffman_encode_file_multistream',
+    'HUFFMAN_DEFAULT_NUM_STREAMS',
+    'huffman_encode_stream',
+    'huffman_decode_stream',
+    'HUFFMAN_DEFAULT_BLOCK_SIZE',
+    'huffman_encode_file_adaptive',
+    'HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE',
+    'huffman_encode_file_compact',
     'huffman_decode_file',
 ]
@@ -1,6 +1,6 @@
 """Constants used throughout libcaf."""
 
-from _libcaf import hash_length
+from _libcaf import HashAlgorithm, hash_length
 
 DEFAULT_REPO_DIR = '.caf'
 OBJECTS_SUBDIR = 'objects'
@@ -8,6 +8,9 @@ HEAD_FILE = 'HEAD'
 DEFAULT_BRANCH = 'main'
 REFS_DIR = 'refs'
 HEADS_DIR = 'heads'
+CONFIG_FILE = 'config'
 
+DEFAULT_HASH_ALGORITHM = HashAlgorithm.SHA1
 HASH_LENGTH = hash_length()
+HASH_LENGTHS = frozenset(hash_length(algorithm) for algorithm in HashAlgorithm.__members__.values())
 HASH_CHARSET = '0123456789abcdef'
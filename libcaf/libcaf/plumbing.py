@@ -1,23 +1,39 @@
 """Low-level plumbing functions for content-addressable storage."""
 
 import os
+from collections.abc import Iterable
 from pathlib import Path
 from typing import IO
 
 import _libcaf
-from _libcaf import Blob, Commit, Tree
+from _libcaf import Blob, Commit, CopyMethod, HashAlgorithm, IngestedFile, ObjectCacheStats, SavedBlob, Tree
 
 from .ref import HashRef
 
 
-def hash_file(filename: str | Path) -> str:
+def hash_file(filename: str | Path, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> str:
     if isinstance(filename, Path):
         filename = str(filename)
 
-    return _libcaf.hash_file(filename)
+    return _libcaf.hash_file(filename, algorithm)
 
-def hash_object(obj: Blob | Commit | Tree) -> HashRef:
-    return HashRef(_libcaf.hash_object(obj))
+def hash_string(content: str, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> str:
+    return _libcaf.hash_string(content, algorithm)
+
+def hash_files(filenames: Iterable[str | Path], algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> list[str]:
+    return _libcaf.hash_files([str(filename) for filename in filenames], algorithm)
+
+def ingest_file(filename: str | Path, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> IngestedFile:
+    if isinstance(filename, Path):
+        filename = str(filename)
+
+    return _libcaf.ingest_file(filename, algorithm)
+
+def hash_object(obj: Blob | Commit | Tree, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> HashRef:
+    if isinstance(obj, Blob):
+        return HashRef(_libcaf.hash_object(obj))
+
+    return HashRef(_libcaf.hash_object(obj, algorithm))
 
 def open_content_for_reading(root_dir: str | Path, hash_value: str) -> IO[bytes]:
     if isinstance(root_dir, Path):
@@ -44,21 +60,48 @@ def delete_content(root_dir: str | Path, hash_value: str) -> None:
     _libcaf.delete_content(root_dir, hash_value)
 
 
-def save_file_content(root_dir: str | Path, file_path: str | Path) -> Blob:
+def repack_content(root_dir: str | Path) -> int:
+    if isinstance(root_dir, Path):
+        root_dir = str(root_dir)
+
+    return _libcaf.repack_content(root_dir)
+
+
+def save_file_content(root_dir: str | Path, file_path: str | Path, compress: bool = False,
+                      verify: bool = False, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> SavedBlob:
     if isinstance(root_dir, Path):
         root_dir = str(root_dir)
 
     if isinstance(file_path, Path):
         file_path = str(file_path)
 
-    return _libcaf.save_file_content(root_dir, file_path)
+    return _libcaf.save_file_content(root_dir, file_path, compress, verify, algorithm)
 
 
-def save_commit(root_dir: str | Path, commit: Commit) -> None:
+def save_files_content(root_dir: str | Path, file_paths: Iterable[str | Path], compress: bool = False,
+                       verify: bool = False, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> list[SavedBlob]:
     if isinstance(root_dir, Path):
         root_dir = str(root_dir)
 
-    _libcaf.save_commit(root_dir, commit)
+    return _libcaf.save_files_content(root_dir, [str(file_path) for file_path in file_paths], compress, verify,
+                                      algorithm)
+
+
+def copy_file(src: str | Path, dest: str | Path) -> CopyMethod:
+    if isinstance(src, Path):
+        src = str(src)
+
+    if isinstance(dest, Path):
+        dest = str(dest)
+
+    return _libcaf.copy_file(src, dest)
+
+
+def save_commit(root_dir: str | Path, commit: Commit, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> None:
+    if isinstance(root_dir, Path):
+        root_dir = str(root_dir)
+
+    _libcaf.save_commit(root_dir, commit, algorithm)
 
 
 def load_commit(root_dir: str | Path, commit_ref: HashRef) -> Commit:
@@ -68,11 +111,11 @@ def load_commit(root_dir: str | Path, commit_ref: HashRef) -> Commit:
     return _libcaf.load_commit(root_dir, commit_ref)
 
 
-def save_tree(root_dir: str | Path, tree: Tree) -> None:
+def save_tree(root_dir: str | Path, tree: Tree, algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> None:
     if isinstance(root_dir, Path):
         root_dir = str(root_dir)
 
-    _libcaf.save_tree(root_dir, tree)
+    _libcaf.save_tree(root_dir, tree, algorithm)
 
 
 def load_tree(root_dir: str | Path, hash_value: str) -> Tree:
@@ -82,15 +125,42 @@ def load_tree(root_dir: str | Path, hash_value: str) -> Tree:
     return _libcaf.load_tree(root_dir, hash_value)
 
 
+def snapshot_directory(dir_path: str | Path, root_dir: str | Path, ignore: Iterable[str] = (), compress: bool = False,
+                       algorithm: HashAlgorithm = HashAlgorithm.SHA1) -> HashRef:
+    return HashRef(_libcaf.snapshot_directory(str(dir_path), str(root_dir), list(ignore), compress, algorithm))
+
+
+def set_object_cache_size(size: int) -> None:
+    _libcaf.set_object_cache_size(size)
+
+
+def object_cache_stats() -> ObjectCacheStats:
+    return _libcaf.object_cache_stats()
+
+
+def clear_object_cache() -> None:
+    _libcaf.clear_object_cache()
+
+
 __all__ = [
+    'clear_object_cache',
+    'copy_file',
     'delete_content',
     'hash_file',
+    'hash_files',
     'hash_object',
+    'hash_string',
+    'ingest_file',
     'load_commit',
     'load_tree',
+    'object_cache_stats',
     'open_content_for_reading',
     'open_content_for_writing',
+    'repack_content',
     'save_commit',
     'save_file_content',
+    'save_files_content',
     'save_tree',
+    'set_object_cache_size',
+    'snapshot_directory',
 ]
@@ -2,7 +2,7 @@
 
 from pathlib import Path
 
-from .constants import HASH_CHARSET, HASH_LENGTH
+from .constants import HASH_CHARSET, HASH_LENGTHS
 
 
 class RefError(Exception):
@@ -43,7 +43,7 @@ def read_ref(ref_file: Path) -> Ref | None:
         if not content:
             return None
 
-        if len(content) == HASH_LENGTH and all(c in HASH_CHARSET for c in content):
+        if len(content) in HASH_LENGTHS and all(c in HASH_CHARSET for c in content):
             return HashRef(content)
 
         msg = f'Invalid reference format in ref file {ref_file}!'
@@ -1,7 +1,6 @@
 """libcaf repository management."""
 
 import shutil
-from collections import deque
 from collections.abc import Callable, Generator, Sequence
 from dataclasses import dataclass
 from datetime import datetime
@@ -9,10 +8,11 @@ from functools import wraps
 from pathlib import Path
 from typing import Concatenate
 
-from . import Blob, Commit, Tree, TreeRecord, TreeRecordType
-from .constants import (DEFAULT_BRANCH, DEFAULT_REPO_DIR, HASH_CHARSET, HASH_LENGTH, HEADS_DIR, HEAD_FILE,
-                        OBJECTS_SUBDIR, REFS_DIR)
-from .plumbing import hash_object, load_commit, load_tree, save_commit, save_file_content, save_tree
+from . import Commit, HashAlgorithm, SavedBlob, TreeRecord, TreeRecordType
+from .constants import (CONFIG_FILE, DEFAULT_BRANCH, DEFAULT_HASH_ALGORITHM, DEFAULT_REPO_DIR, HASH_CHARSET,
+                        HASH_LENGTHS, HEADS_DIR, HEAD_FILE, OBJECTS_SUBDIR, REFS_DIR)
+from .plumbing import (hash_object, load_commit, load_tree, open_content_for_reading, repack_content, save_commit,
+                       save_file_content, snapshot_directory)
 from .ref import HashRef, Ref, RefError, SymRef, read_ref, write_ref
 
 
@@ -88,14 +88,20 @@ class Repository:
         else:
             self.repo_dir = Path(repo_dir)
 
-    def init(self, default_branch: str = DEFAULT_BRANCH) -> None:
+    def init(self, default_branch: str = DEFAULT_BRANCH, compress_objects: bool = False,
+             hash_algorithm: HashAlgorithm = DEFAULT_HASH_ALGORITHM) -> None:
         """Initialize a new CAF repository in the working directory.
 
         :param default_branch: The name of the default branch to create. Defaults to 'main'.
+        :param compress_objects: Store file contents Huffman-compressed. Defaults to False.
+        :param hash_algorithm: The digest used to name the objects of the repository. Defaults to SHA-1.
         :raises RepositoryError: If the repository already exists or if the working directory is invalid."""
         self.repo_path().mkdir(parents=True)
         self.objects_dir().mkdir()
 
+        self.config_file().write_text(f'compress_objects = {str(compress_objects).lower()}\n'
+                                      f'hash_algorithm = {hash_algorithm.name.lower()}\n')
+
         heads_dir = self.heads_dir()
         heads_dir.mkdir(parents=True)
 
@@ -121,6 +127,50 @@ class Repository:
         :return: The path to the objects directory."""
         return self.repo_path() / OBJECTS_SUBDIR
 
+    def config_file(self) -> Path:
+        """Get the path to the configuration file within the repository.
+
+        :return: The path to the configuration file."""
+        return self.repo_path() / CONFIG_FILE
+
+    def config(self) -> dict[str, str]:
+        """Read the repository configuration. Repositories created before the configuration file existed have none.
+
+        :return: A dictionary of the configuration keys and their values."""
+        config_file = self.config_file()
+        if not config_file.exists():
+            return {}
+
+        config: dict[str, str] = {}
+        for line in config_file.read_text().splitlines():
+            key, sep, value = line.partition('=')
+            if sep:
+                config[key.strip()] = value.strip()
+
+        return config
+
+    def compress_objects(self) -> bool:
+        """Check whether new file contents are stored compressed in this repository.
+
+        Objects saved either way can be read back, each one records how it was stored.
+
+        :return: True if new file contents are stored compressed, False otherwise."""
+        return self.config().get('compress_objects') == 'true'
+
+    def hash_algorithm(self) -> HashAlgorithm:
+        """Get the digest used to name the objects of this repository.
+
+        :return: The hash algorithm of the repository, SHA-1 for repositories that don't configure one.
+        :raises RepositoryError: If the configured hash algorithm is unknown."""
+        name = self.config().get('hash_algorithm', DEFAULT_HASH_ALGORITHM.name.lower())
+
+        algorithm = HashAlgorithm.__members__.get(name.upper())
+        if algorithm is None:
+            msg = f'Unknown hash algorithm {name} in {self.config_file()}'
+            raise RepositoryError(msg)
+
+        return algorithm
+
     def refs_dir(self) -> Path:
         """Get the path to the refs directory within the repository.
 
@@ -217,7 +267,7 @@ class Repository:
                 # in the refs directory
                 if ref.upper() == 'HEAD' or ref in self.refs():
                     return self.resolve_ref(SymRef(ref))
-                if len(ref) == HASH_LENGTH and all(c in HASH_CHARSET for c in ref):
+                if len(ref) in HASH_LENGTHS and all(c in HASH_CHARSET for c in ref):
                     return HashRef(ref)
 
                 msg = f'Invalid reference: {ref}'
@@ -252,14 +302,34 @@ class Repository:
         shutil.rmtree(self.repo_path())
 
     @requires_repo
-    def save_file_content(self, file: Path) -> Blob:
-        """Save the content of a file to the repository.
+    def save_file_content(self, file: Path, verify: bool = False) -> SavedBlob:
+        """Save the content of a file to the repository. Content that is already stored is not written again.
 
         :param file: The path to the file to save.
-        :return: A Blob object representing the saved file content.
+        :param verify: Compare already stored content with the file instead of trusting its size. Defaults to False.
+        :return: A SavedBlob object representing the saved file content and whether it was newly stored.
         :raises ValueError: If the file does not exist.
         :raises RepositoryNotFoundError: If the repository does not exist."""
-        return save_file_content(self.objects_dir(), file)
+        return save_file_content(self.objects_dir(), file, self.compress_objects(), verify, self.hash_algorithm())
+
+    @requires_repo
+    def read_file_content(self, blob_hash: str) -> bytes:
+        """Read back the content of a file saved to the repository, decompressing it if needed.
+
+        :param blob_hash: The hash of the saved file content.
+        :return: The content of the file.
+        :raises RuntimeError: If the content does not exist.
+        :raises RepositoryNotFoundError: If the repository does not exist."""
+        with open_content_for_reading(self.objects_dir(), blob_hash) as f:
+            return f.read()
+
+    @requires_repo
+    def repack(self) -> int:
+        """Move all the objects of the repository into a single pack, so reading one doesn't cost a file of its own.
+
+        :return: The number of objects in the pack.
+        :raises RepositoryNotFoundError: If the repository does not exist."""
+        return repack_content(self.objects_dir())
 
     @requires_repo
     def add_branch(self, branch: str) -> None:
@@ -329,33 +399,9 @@ class Repository:
             msg = f'{path} is not a directory'
             raise NotADirectoryError(msg)
 
-        stack = deque([path])
-        hashes: dict[Path, str] = {}
-
-        while stack:
-            current_path = stack.pop()
-            tree_records: dict[str, TreeRecord] = {}
-
-            for item in current_path.iterdir():
-                if item.name == self.repo_dir.name:
-                    continue
-                if item.is_file():
-                    blob = self.save_file_content(item)
-                    tree_records[item.name] = TreeRecord(TreeRecordType.BLOB, blob.hash, item.name)
-                elif item.is_dir():
-                    if item in hashes:  # If the directory has already been processed, use its hash
-                        subtree_hash = hashes[item]
-                        tree_records[item.name] = TreeRecord(TreeRecordType.TREE, subtree_hash, item.name)
-                    else:
-                        stack.append(current_path)
-                        stack.append(item)
-                        break
-            else:
-                tree = Tree(tree_records)
-                save_tree(self.objects_dir(), tree)
-                hashes[current_path] = hash_object(tree)
-
-        return HashRef(hashes[path])
+        # The directory is walked, stored and turned into trees natively, see snapshot_directory
+        return snapshot_directory(path, self.objects_dir(), [self.repo_dir.name], self.compress_objects(),
+                                  self.hash_algorithm())
 
     @requires_repo
     def commit_working_dir(self, author: str, message: str) -> HashRef:
@@ -387,9 +433,9 @@ class Repository:
         tree_hash = self.save_dir(self.working_dir)
 
         commit = Commit(tree_hash, author, message, int(datetime.now().timestamp()), parent_commit_ref)
-        commit_ref = HashRef(hash_object(commit))
+        commit_ref = HashRef(hash_object(commit, self.hash_algorithm()))
 
-        save_commit(self.objects_dir(), commit)
+        save_commit(self.objects_dir(), commit, self.hash_algorithm())
 
         if branch:
             self.update_ref(branch, commit_ref)
@@ -458,7 +504,7 @@ class Repository:
             msg = 'Error loading tree'
             raise RepositoryError(msg) from e
 
-        top_level_diff = Diff(TreeRecord(TreeRecordType.TREE, '', ''), None, [])
+        top_level_diff = Diff(TreeRecord(TreeRecordType.TREE, commit1.tree_hash, ''), None, [])
         stack = [(tree1, tree2, top_level_diff)]
 
         potentially_added: dict[str, Diff] = {}
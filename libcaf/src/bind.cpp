@@ -1,6 +1,7 @@
 #include "caf.h"
 #include "hash_types.h"
 #include "object_io.h"
+#include "snapshot.h"
 #include "huffman/huffman.h"
 #include "util/bitreader.h"
 
@@ -59,58 +60,122 @@ BitReader create_reader(py::buffer b, size_t data_size_in_bits) {
 
 PYBIND11_MODULE(_libcaf, m) {
     // caf
-    m.def("hash_file", hash_file);
-    m.def("hash_string", hash_string);
-    m.def("hash_length", hash_length);
-    m.def("save_file_content", save_file_content);
+    // registered first, the functions below use it as a default argument
+    py::enum_<HashAlgorithm>(m, "HashAlgorithm")
+    .value("SHA1", HashAlgorithm::SHA1)
+    .value("SHA256", HashAlgorithm::SHA256)
+    .value("BLAKE3", HashAlgorithm::BLAKE3);
+
+    m.def("hash_file", hash_file, py::arg("file_path"), py::arg("algorithm") = HashAlgorithm::SHA1);
+    m.def("hash_string", hash_string, py::arg("content"), py::arg("algorithm") = HashAlgorithm::SHA1);
+    m.def("hash_length", hash_length, py::arg("algorithm") = HashAlgorithm::SHA1);
+    m.def("ingest_file", ingest_file, py::arg("file_path"), py::arg("algorithm") = HashAlgorithm::SHA1);
+    m.def("save_file_content", save_file_content,
+          py::arg("content_root_dir"), py::arg("file_path"), py::arg("compress") = false,
+          py::arg("verify") = false, py::arg("algorithm") = HashAlgorithm::SHA1);
+
+    m.def("hash_files", hash_files, py::arg("file_paths"), py::arg("algorithm") = HashAlgorithm::SHA1,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("save_files_content", save_files_content,
+          py::arg("content_root_dir"), py::arg("file_paths"), py::arg("compress") = false, py::arg("verify") = false,
+          py::arg("algorithm") = HashAlgorithm::SHA1, py::call_guard<py::gil_scoped_release>());
+
+    py::enum_<CopyMethod>(m, "CopyMethod")
+    .value("REFLINK", CopyMethod::REFLINK)
+    .value("COPY_FILE_RANGE", CopyMethod::COPY_FILE_RANGE)
+    .value("SENDFILE", CopyMethod::SENDFILE)
+    .value("BUFFERED", CopyMethod::BUFFERED);
+
+    m.def("copy_file", copy_file, py::arg("src"), py::arg("dest"));
     m.def("open_content_for_writing", open_content_for_writing);
     m.def("delete_content", delete_content);
-    m.def("open_content_for_reading", open_content_for_reading);
+    m.def("repack_content", repack_content, py::arg("content_root_dir"), py::call_guard<py::gil_scoped_release>());
+    m.def("open_content_for_reading", open_content_for_reading,
+          py::arg("content_root_dir"), py::arg("content_hash"));
 
     // huffman constants
     m.attr("HUFFMAN_HEADER_SIZE") = HUFFMAN_HEADER_SIZE;
+    m.attr("HUFFMAN_STORED_HEADER_SIZE") = HUFFMAN_STORED_HEADER_SIZE;
 
     // hash_types
     m.def("hash_object", py::overload_cast<const Blob&>(&hash_object), py::arg("blob"));
-    m.def("hash_object", py::overload_cast<const Tree&>(&hash_object), py::arg("tree"));
-    m.def("hash_object", py::overload_cast<const Commit&>(&hash_object), py::arg("commit"));
+    m.def("hash_object", py::overload_cast<const Tree&, const HashAlgorithm>(&hash_object), py::arg("tree"),
+          py::arg("algorithm") = HashAlgorithm::SHA1);
+    m.def("hash_object", py::overload_cast<const Commit&, const HashAlgorithm>(&hash_object), py::arg("commit"),
+          py::arg("algorithm") = HashAlgorithm::SHA1);
 
     // object_io
-    m.def("save_commit", &save_commit);
+    m.def("save_commit", &save_commit, py::arg("root_dir"), py::arg("commit"), py::arg("algorithm") = HashAlgorithm::SHA1);
     m.def("load_commit", &load_commit);
-    m.def("save_tree", &save_tree);
+    m.def("save_tree", &save_tree, py::arg("root_dir"), py::arg("tree"), py::arg("algorithm") = HashAlgorithm::SHA1);
     m.def("load_tree", &load_tree);
+    m.def("set_object_cache_size", &set_object_cache_size, py::arg("size"));
+    m.def("object_cache_stats", &object_cache_stats);
+    m.def("clear_object_cache", &clear_object_cache);
+    m.attr("DEFAULT_OBJECT_CACHE_SIZE") = DEFAULT_OBJECT_CACHE_SIZE;
+
+    // snapshot
+    m.def("snapshot_directory", &snapshot_directory, py::arg("dir_path"), py::arg("content_root_dir"),
+          py::arg("ignore") = std::vector<std::string>(), py::arg("compress") = false,
+          py::arg("algorithm") = HashAlgorithm::SHA1, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<LruCacheStats>(m, "LruCacheStats")
+    .def_readonly("hits", &LruCacheStats::hits)
+    .def_readonly("misses", &LruCacheStats::misses)
+    .def_readonly("size", &LruCacheStats::size)
+    .def_readonly("capacity", &LruCacheStats::capacity);
+
+    py::class_<ObjectCacheStats>(m, "ObjectCacheStats")
+    .def_readonly("trees", &ObjectCacheStats::trees)
+    .def_readonly("commits", &ObjectCacheStats::commits);
+
+    py::class_<IngestedFile>(m, "IngestedFile")
+    .def_readonly("hash", &IngestedFile::hash)
+    .def_readonly("histogram", &IngestedFile::histogram);
 
     py::class_<Blob>(m, "Blob")
     .def(py::init<std::string>())
     .def_readonly("hash", &Blob::hash);
 
+    py::class_<SavedBlob, Blob>(m, "SavedBlob")
+    .def_readonly("created", &SavedBlob::created);
+
     py::enum_<TreeRecord::Type>(m, "TreeRecordType")
     .value("TREE", TreeRecord::Type::TREE)
     .value("BLOB", TreeRecord::Type::BLOB)
     .value("COMMIT", TreeRecord::Type::COMMIT)
     .export_values();
 
+    // hashes are hex strings in Python, a string that isn't an object hash raises ValueError
     py::class_<TreeRecord>(m, "TreeRecord")
-    .def(py::init<TreeRecord::Type, std::string, std::string>())
+    .def(py::init([](TreeRecord::Type type, const std::string& hash, std::string name) {
+        return TreeRecord(type, ObjectId::parse_hex(hash), std::move(name));
+    }))
     .def_readonly("type", &TreeRecord::type)
-    .def_readonly("hash", &TreeRecord::hash)
+    .def_property_readonly("hash", [](const TreeRecord &self) { return self.hash.to_hex(); })
     .def_readonly("name", &TreeRecord::name)
     .def("__eq__", [](const TreeRecord &self, const TreeRecord &other) {
         return self.type == other.type && self.hash == other.hash && self.name == other.name;
     });
 
-    py::class_<Tree>(m, "Tree")
+    // loaded trees and commits are shared with the object cache
+    py::class_<Tree, std::shared_ptr<Tree>>(m, "Tree")
     .def(py::init<const std::map<std::string, TreeRecord>&>())
     .def_readonly("records", &Tree::records);
 
-    py::class_<Commit>(m, "Commit")
-        .def(py::init<const string &, const string&, const string&, time_t, const std::optional<std::string>&>())
-        .def_readonly("tree_hash", &Commit::tree_hash)
+    py::class_<Commit, std::shared_ptr<Commit>>(m, "Commit")
+        .def(py::init([](const string& tree_hash, const string& author, const string& message, time_t timestamp,
+                         const std::optional<std::string>& parent) {
+            return std::make_shared<Commit>(ObjectId::parse_hex(tree_hash), author, message, timestamp,
+                                            parent ? std::make_optional(ObjectId::parse_hex(*parent)) : std::nullopt);
+        }))
+        .def_property_readonly("tree_hash", [](const Commit &self) { return self.tree_hash.to_hex(); })
         .def_readonly("author", &Commit::author)
         .def_readonly("message", &Commit::message)
         .def_readonly("timestamp", &Commit::timestamp)
-        .def_readonly("parent", &Commit::parent);
+        .def_property_readonly("parent", [](const Commit &self) {
+            return self.parent ? std::make_optional(self.parent->to_hex()) : std::nullopt;
+        });
 
     // histogram for huffman compression
     m.def("histogram", [](py::array_t<uint8_t, py::array::c_style> array) {
@@ -149,6 +214,15 @@ PYBIND11_MODULE(_libcaf, m) {
         return histogram_fast(std::span<const std::byte>(ptr, static_cast<size_t>(info.shape[0])));
     }, py::arg("data"));
 
+    m.def("histogram_subtables", [](py::array_t<uint8_t, py::array::c_style> array) {
+        auto info = array.request();
+        if (info.ndim != 1) {
+            throw std::runtime_error("histogram_subtables expects a 1-D numpy array");
+        }
+        auto* ptr = static_cast<const std::byte*>(info.ptr);
+        return histogram_subtables(std::span<const std::byte>(ptr, static_cast<size_t>(info.shape[0])));
+    }, py::arg("data"));
+
     // huffman_tree bindings
     py::class_<LeafNodeData>(m, "LeafNodeData")
         .def_readonly("symbol", &LeafNodeData::symbol);
@@ -182,6 +256,7 @@ PYBIND11_MODULE(_libcaf, m) {
         });
 
     m.def("huffman_tree", &huffman_tree);
+    m.def("huffman_code_lengths", &huffman_code_lengths, py::arg("hist"), py::arg("max_code_len") = MAX_CODE_LEN);
 
     // huffman_dict bindings
     m.def("huffman_dict", &huffman_dict);
@@ -192,6 +267,7 @@ PYBIND11_MODULE(_libcaf, m) {
     }, py::arg("dict"));
 
     m.def("next_canonical_huffman_code", &next_canonical_huffman_code, py::arg("code"));
+    m.def("reconstruct_canonical_dict", &reconstruct_canonical_dict, py::arg("code_lengths"));
 
     m.def("calculate_compressed_size_in_bits", [](py::array_t<uint64_t, py::array::c_style> hist,
                                                    const std::array<std::vector<bool>, 256>& dict) {
@@ -201,7 +277,7 @@ PYBIND11_MODULE(_libcaf, m) {
         }
         std::array<uint64_t, 256> hist_arr;
         std::memcpy(hist_arr.data(), info.ptr, 256 * sizeof(uint64_t));
-        return calculate_compressed_size_in_bits(hist_arr, dict);
+        return calculate_compressed_size_in_bits(hist_arr, huffman_code_table(dict));
     }, py::arg("hist"), py::arg("dict"));
 
     // huffman_encode_span bindings (for benchmarking different implementations)
@@ -218,21 +294,21 @@ PYBIND11_MODULE(_libcaf, m) {
         huffman_encode_span(
             std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
             std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
-            dict);
+            huffman_code_table(dict));
     }, py::arg("source"), py::arg("destination"), py::arg("dict"));
 
     m.def("huffman_build_reverse_dict", 
-        [](const std::array<std::vector<bool>, 256>& dict, size_t max_code_len) {
-            auto result_array = huffman_build_reverse_dict(dict, max_code_len);
-            return std::vector<uint16_t>(result_array.begin(), result_array.end());
+        [](const std::array<std::vector<bool>, 256>& dict, size_t table_bits) {
+            return huffman_build_reverse_dict(huffman_code_table(dict), table_bits);
         },
-        py::arg("dict"), py::arg("max_code_len")
+        py::arg("dict"), py::arg("table_bits")
     );
 
     m.def("huffman_decode_span", [](py::array_t<uint8_t, py::array::c_style> source,
                                     const size_t source_size_in_bits,
                                     py::array_t<uint8_t, py::array::c_style> destination,
-                                    const std::array<std::vector<bool>, 256>& dict) {
+                                    const std::array<std::vector<bool>, 256>& dict,
+                                    const size_t table_bits) {
         auto src_info = source.request();
         auto dst_info = destination.request(true);
         if (src_info.ndim != 1 || dst_info.ndim != 1) {
@@ -244,8 +320,30 @@ PYBIND11_MODULE(_libcaf, m) {
             std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
             source_size_in_bits,
             std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
-            dict);
-    }, py::arg("source"), py::arg("source_size_in_bits"), py::arg("destination"), py::arg("dict"));
+            huffman_code_table(dict),
+            table_bits);
+    }, py::arg("source"), py::arg("source_size_in_bits"), py::arg("destination"), py::arg("dict"),
+       py::arg("table_bits") = MAX_CODE_LEN);
+
+    m.def("huffman_decode_span_multisymbol", [](py::array_t<uint8_t, py::array::c_style> source,
+                                                 const size_t source_size_in_bits,
+                                                 py::array_t<uint8_t, py::array::c_style> destination,
+                                                 const std::array<std::vector<bool>, 256>& dict,
+                                                 const size_t table_bits) {
+        auto src_info = source.request();
+        auto dst_info = destination.request(true);
+        if (src_info.ndim != 1 || dst_info.ndim != 1) {
+            throw std::runtime_error("huffman_decode_span_multisymbol expects 1-D numpy arrays");
+        }
+        auto* src_ptr = static_cast<const std::byte*>(src_info.ptr);
+        auto* dst_ptr = static_cast<std::byte*>(dst_info.ptr);
+        huffman_decode_span_multisymbol(
+            std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
+            source_size_in_bits,
+            std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
+            huffman_build_decode_table(huffman_code_table(dict), table_bits));
+    }, py::arg("source"), py::arg("source_size_in_bits"), py::arg("destination"), py::arg("dict"),
+       py::arg("table_bits") = MAX_CODE_LEN);
 
     m.def("huffman_encode_span_parallel", [](py::array_t<uint8_t, py::array::c_style> source,
                                               py::array_t<uint8_t, py::array::c_style> destination,
@@ -260,7 +358,7 @@ PYBIND11_MODULE(_libcaf, m) {
         huffman_encode_span_parallel(
             std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
             std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
-            dict);
+            huffman_code_table(dict));
     }, py::arg("source"), py::arg("destination"), py::arg("dict"));
 
     m.def("huffman_encode_span_parallel_twopass", [](py::array_t<uint8_t, py::array::c_style> source,
@@ -276,12 +374,51 @@ PYBIND11_MODULE(_libcaf, m) {
         huffman_encode_span_parallel_twopass(
             std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
             std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
-            dict);
+            huffman_code_table(dict));
+    }, py::arg("source"), py::arg("destination"), py::arg("dict"));
+
+    m.def("huffman_encode_span_64bit", [](py::array_t<uint8_t, py::array::c_style> source,
+                                           py::array_t<uint8_t, py::array::c_style> destination,
+                                           const std::array<std::vector<bool>, 256>& dict) {
+        auto src_info = source.request();
+        auto dst_info = destination.request(true);
+        if (src_info.ndim != 1 || dst_info.ndim != 1) {
+            throw std::runtime_error("huffman_encode_span_64bit expects 1-D numpy arrays");
+        }
+        auto* src_ptr = static_cast<const std::byte*>(src_info.ptr);
+        auto* dst_ptr = static_cast<std::byte*>(dst_info.ptr);
+        huffman_encode_span_64bit(
+            std::span<const std::byte>(src_ptr, static_cast<size_t>(src_info.shape[0])),
+            std::span<std::byte>(dst_ptr, static_cast<size_t>(dst_info.shape[0])),
+            huffman_code_table(dict));
     }, py::arg("source"), py::arg("destination"), py::arg("dict"));
 
     // huffman_encdec bindings
-    m.def("huffman_encode_file", &huffman_encode_file);
+    m.def("huffman_encode_file", &huffman_encode_file,
+          py::arg("input_file"), py::arg("output_file"), py::arg("max_code_len") = MAX_CODE_LEN,
+          py::arg("store_incompressible") = false);
+    m.def("huffman_encode_file_indexed", &huffman_encode_file_indexed,
+          py::arg("input_file"), py::arg("output_file"),
+          py::arg("index_interval") = HUFFMAN_DEFAULT_INDEX_INTERVAL, py::arg("max_code_len") = MAX_CODE_LEN);
+    m.def("huffman_encode_file_multistream", &huffman_encode_file_multistream,
+          py::arg("input_file"), py::arg("output_file"),
+          py::arg("num_streams") = HUFFMAN_DEFAULT_NUM_STREAMS, py::arg("max_code_len") = MAX_CODE_LEN);
+    m.def("huffman_encode_file_adaptive", &huffman_encode_file_adaptive,
+          py::arg("input_file"), py::arg("output_file"),
+          py::arg("block_size") = HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE, py::arg("max_code_len") = MAX_CODE_LEN);
+    m.def("huffman_encode_file_compact", &huffman_encode_file_compact,
+          py::arg("input_file"), py::arg("output_file"), py::arg("max_code_len") = MAX_CODE_LEN,
+          py::arg("store_incompressible") = false);
     m.def("huffman_decode_file", &huffman_decode_file);
+    m.def("huffman_encode_stream", &huffman_encode_stream,
+          py::arg("input_fd"), py::arg("output_fd"),
+          py::arg("block_size") = HUFFMAN_DEFAULT_BLOCK_SIZE, py::arg("max_code_len") = MAX_CODE_LEN);
+    m.def("huffman_decode_stream", &huffman_decode_stream, py::arg("input_fd"), py::arg("output_fd"));
+
+    m.attr("HUFFMAN_DEFAULT_INDEX_INTERVAL") = HUFFMAN_DEFAULT_INDEX_INTERVAL;
+    m.attr("HUFFMAN_DEFAULT_NUM_STREAMS") = HUFFMAN_DEFAULT_NUM_STREAMS;
+    m.attr("HUFFMAN_DEFAULT_BLOCK_SIZE") = HUFFMAN_DEFAULT_BLOCK_SIZE;
+    m.attr("HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE") = HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE;
 
     m.attr("MAX_CODE_LEN") = MAX_CODE_LEN;
 
@@ -293,5 +430,6 @@ PYBIND11_MODULE(_libcaf, m) {
              py::keep_alive<1, 2>())
         .def("read", &BitReader::read, py::arg("n_bits"))
         .def("advance", &BitReader::advance, py::arg("n_bits"))
-        .def("done", &BitReader::done);
+        .def("done", &BitReader::done)
+        .def("remaining", &BitReader::remaining);
 }
\ No newline at end of file
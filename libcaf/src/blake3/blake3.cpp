@@ -0,0 +1,478 @@
+#include "blake3.h"
+
+#include <omp.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+constexpr std::array<uint32_t, 8> IV = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+constexpr std::array<size_t, 16> MSG_PERMUTATION = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+
+// The message words used by each of the 7 rounds, the permutation applied round after round, so compress can index
+// the block directly instead of permuting a copy of it between rounds.
+constexpr std::array<std::array<size_t, 16>, 7> MSG_SCHEDULE = [] {
+    std::array<std::array<size_t, 16>, 7> schedule{};
+    for (size_t i = 0; i < 16; ++i) {
+        schedule[0][i] = i;
+    }
+    for (size_t r = 1; r < 7; ++r) {
+        for (size_t i = 0; i < 16; ++i) {
+            schedule[r][i] = schedule[r - 1][MSG_PERMUTATION[i]];
+        }
+    }
+    return schedule;
+}();
+
+constexpr uint32_t CHUNK_START = 1 << 0;
+constexpr uint32_t CHUNK_END = 1 << 1;
+constexpr uint32_t PARENT = 1 << 2;
+constexpr uint32_t ROOT = 1 << 3;
+
+// Subtrees passed to update in one call are split into up to this many pieces of at least this size, which are
+// hashed on separate threads.
+constexpr size_t PARALLEL_MAX_PIECES = 64;
+constexpr size_t PARALLEL_MIN_PIECE_LEN = 64 * BLAKE3_CHUNK_LEN;
+
+constexpr size_t BLOCKS_PER_CHUNK = BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN;
+
+using ChainingValue = std::array<uint32_t, 8>;
+using BlockWords = std::array<uint32_t, 16>;
+
+static inline void g(std::array<uint32_t, 16>& state, const size_t a, const size_t b, const size_t c, const size_t d,
+                     const uint32_t mx, const uint32_t my) {
+    state[a] = state[a] + state[b] + mx;
+    state[d] = std::rotr(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = std::rotr(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + my;
+    state[d] = std::rotr(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = std::rotr(state[b] ^ state[c], 7);
+}
+
+static inline void round_function(std::array<uint32_t, 16>& state, const BlockWords& m, const std::array<size_t, 16>& schedule) {
+    // columns
+    g(state, 0, 4, 8, 12, m[schedule[0]], m[schedule[1]]);
+    g(state, 1, 5, 9, 13, m[schedule[2]], m[schedule[3]]);
+    g(state, 2, 6, 10, 14, m[schedule[4]], m[schedule[5]]);
+    g(state, 3, 7, 11, 15, m[schedule[6]], m[schedule[7]]);
+    // diagonals
+    g(state, 0, 5, 10, 15, m[schedule[8]], m[schedule[9]]);
+    g(state, 1, 6, 11, 12, m[schedule[10]], m[schedule[11]]);
+    g(state, 2, 7, 8, 13, m[schedule[12]], m[schedule[13]]);
+    g(state, 3, 4, 9, 14, m[schedule[14]], m[schedule[15]]);
+}
+
+static std::array<uint32_t, 16> compress(const ChainingValue& cv, const BlockWords& block, const uint64_t counter,
+                                         const uint32_t block_len, const uint32_t flags) {
+    std::array<uint32_t, 16> state = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        IV[0], IV[1], IV[2], IV[3],
+        static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), block_len, flags
+    };
+
+    #pragma GCC unroll 7
+    for (const auto& schedule : MSG_SCHEDULE) {
+        round_function(state, block, schedule);
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        state[i] ^= state[i + 8];
+        state[i + 8] ^= cv[i];
+    }
+
+    return state;
+}
+
+static ChainingValue first_8_words(const std::array<uint32_t, 16>& state) {
+    ChainingValue cv;
+    std::copy_n(state.begin(), 8, cv.begin());
+    return cv;
+}
+
+static BlockWords words_from_bytes(const uint8_t* bytes) {
+    BlockWords words;
+    for (size_t i = 0; i < 16; ++i) {
+        words[i] = static_cast<uint32_t>(bytes[4 * i]) |
+                   static_cast<uint32_t>(bytes[4 * i + 1]) << 8 |
+                   static_cast<uint32_t>(bytes[4 * i + 2]) << 16 |
+                   static_cast<uint32_t>(bytes[4 * i + 3]) << 24;
+    }
+    return words;
+}
+
+// The last compression of a chunk or parent node, kept unevaluated until it's known whether it's the root.
+struct Output {
+    ChainingValue input_cv;
+    BlockWords block;
+    uint64_t counter;
+    uint32_t block_len;
+    uint32_t flags;
+
+    ChainingValue chaining_value() const {
+        return first_8_words(compress(input_cv, block, counter, block_len, flags));
+    }
+
+    std::array<uint8_t, BLAKE3_OUT_LEN> root_bytes() const {
+        const std::array<uint32_t, 16> words = compress(input_cv, block, 0, block_len, flags | ROOT);
+
+        std::array<uint8_t, BLAKE3_OUT_LEN> out;
+        for (size_t i = 0; i < BLAKE3_OUT_LEN / 4; ++i) {
+            out[4 * i] = static_cast<uint8_t>(words[i]);
+            out[4 * i + 1] = static_cast<uint8_t>(words[i] >> 8);
+            out[4 * i + 2] = static_cast<uint8_t>(words[i] >> 16);
+            out[4 * i + 3] = static_cast<uint8_t>(words[i] >> 24);
+        }
+        return out;
+    }
+};
+
+static Output parent_output(const ChainingValue& left, const ChainingValue& right) {
+    BlockWords block;
+    std::copy(left.begin(), left.end(), block.begin());
+    std::copy(right.begin(), right.end(), block.begin() + 8);
+    return Output{IV, block, 0, BLAKE3_BLOCK_LEN, PARENT};
+}
+
+static void chunk_init(Blake3ChunkState& chunk, const uint64_t chunk_counter) {
+    chunk.cv = IV;
+    chunk.chunk_counter = chunk_counter;
+    chunk.block.fill(0);
+    chunk.block_len = 0;
+    chunk.blocks_compressed = 0;
+}
+
+static size_t chunk_len(const Blake3ChunkState& chunk) {
+    return BLAKE3_BLOCK_LEN * chunk.blocks_compressed + chunk.block_len;
+}
+
+static uint32_t chunk_start_flag(const Blake3ChunkState& chunk) {
+    return chunk.blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+static void chunk_update(Blake3ChunkState& chunk, const uint8_t* input, size_t input_len) {
+    while (input_len > 0) {
+        // a full block is only compressed once more input arrives, the last block of the chunk needs CHUNK_END
+        if (chunk.block_len == BLAKE3_BLOCK_LEN) {
+            chunk.cv = first_8_words(compress(chunk.cv, words_from_bytes(chunk.block.data()), chunk.chunk_counter,
+                                              BLAKE3_BLOCK_LEN, chunk_start_flag(chunk)));
+            chunk.blocks_compressed++;
+            chunk.block.fill(0);
+            chunk.block_len = 0;
+        }
+
+        const size_t take = std::min(BLAKE3_BLOCK_LEN - chunk.block_len, input_len);
+        std::memcpy(chunk.block.data() + chunk.block_len, input, take);
+        chunk.block_len += take;
+        input += take;
+        input_len -= take;
+    }
+}
+
+static Output chunk_output(const Blake3ChunkState& chunk) {
+    return Output{chunk.cv, words_from_bytes(chunk.block.data()), chunk.chunk_counter, chunk.block_len,
+                  chunk_start_flag(chunk) | CHUNK_END};
+}
+
+static ChainingValue chunk_cv(const uint8_t* input, const uint64_t chunk_counter) {
+    // a whole chunk is in memory, its blocks are compressed straight from the input without buffering them
+    ChainingValue cv = IV;
+    for (size_t block = 0; block < BLOCKS_PER_CHUNK; ++block) {
+        uint32_t flags = 0;
+        if (block == 0)
+            flags |= CHUNK_START;
+        if (block == BLOCKS_PER_CHUNK - 1)
+            flags |= CHUNK_END;
+        cv = first_8_words(compress(cv, words_from_bytes(input + block * BLAKE3_BLOCK_LEN), chunk_counter,
+                                    BLAKE3_BLOCK_LEN, flags));
+    }
+    return cv;
+}
+
+// The vector kernels hash LANES consecutive chunks at once, lane i of every state word belongs to chunk i. The
+// generic code is written with GCC vector extensions and compiled once per instruction set by inlining it into the
+// target specific wrappers below.
+template <size_t LANES>
+struct LaneVector;
+
+template <>
+struct LaneVector<8> {
+    typedef uint32_t type __attribute__((vector_size(8 * sizeof(uint32_t))));
+};
+
+template <>
+struct LaneVector<16> {
+    typedef uint32_t type __attribute__((vector_size(16 * sizeof(uint32_t))));
+};
+
+template <size_t LANES>
+using LaneWords = typename LaneVector<LANES>::type;
+
+// Vectors are only passed by reference, passing them by value would depend on the instruction set of the caller.
+template <size_t LANES, int N>
+static inline __attribute__((always_inline)) void rotr_lanes(LaneWords<LANES>& x) {
+    x = (x >> N) | (x << (32 - N));
+}
+
+template <size_t LANES>
+static inline __attribute__((always_inline)) void g_lanes(std::array<LaneWords<LANES>, 16>& v, const size_t a,
+                                                          const size_t b, const size_t c, const size_t d,
+                                                          const LaneWords<LANES>& mx, const LaneWords<LANES>& my) {
+    v[a] = v[a] + v[b] + mx;
+    v[d] ^= v[a];
+    rotr_lanes<LANES, 16>(v[d]);
+    v[c] = v[c] + v[d];
+    v[b] ^= v[c];
+    rotr_lanes<LANES, 12>(v[b]);
+    v[a] = v[a] + v[b] + my;
+    v[d] ^= v[a];
+    rotr_lanes<LANES, 8>(v[d]);
+    v[c] = v[c] + v[d];
+    v[b] ^= v[c];
+    rotr_lanes<LANES, 7>(v[b]);
+}
+
+template <size_t LANES>
+static inline __attribute__((always_inline)) void hash_chunks_lanes(const uint8_t* input, const uint64_t chunk_counter,
+                                                                    ChainingValue* out) {
+    using Vec = LaneWords<LANES>;
+
+    std::array<Vec, 8> cv;
+    for (size_t i = 0; i < 8; ++i) {
+        cv[i] = Vec{} + IV[i];
+    }
+
+    Vec counter_low, counter_high;
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        counter_low[lane] = static_cast<uint32_t>(chunk_counter + lane);
+        counter_high[lane] = static_cast<uint32_t>((chunk_counter + lane) >> 32);
+    }
+
+    for (size_t block = 0; block < BLOCKS_PER_CHUNK; ++block) {
+        std::array<Vec, 16> m;
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            const uint8_t* bytes = input + lane * BLAKE3_CHUNK_LEN + block * BLAKE3_BLOCK_LEN;
+            for (size_t word = 0; word < 16; ++word) {
+                uint32_t value;
+                std::memcpy(&value, bytes + 4 * word, sizeof(value));
+                m[word][lane] = value;
+            }
+        }
+
+        uint32_t flags = 0;
+        if (block == 0)
+            flags |= CHUNK_START;
+        if (block == BLOCKS_PER_CHUNK - 1)
+            flags |= CHUNK_END;
+
+        std::array<Vec, 16> v = {
+            cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+            Vec{} + IV[0], Vec{} + IV[1], Vec{} + IV[2], Vec{} + IV[3],
+            counter_low, counter_high, Vec{} + static_cast<uint32_t>(BLAKE3_BLOCK_LEN), Vec{} + flags
+        };
+
+        #pragma GCC unroll 7
+        for (const auto& schedule : MSG_SCHEDULE) {
+            g_lanes<LANES>(v, 0, 4, 8, 12, m[schedule[0]], m[schedule[1]]);
+            g_lanes<LANES>(v, 1, 5, 9, 13, m[schedule[2]], m[schedule[3]]);
+            g_lanes<LANES>(v, 2, 6, 10, 14, m[schedule[4]], m[schedule[5]]);
+            g_lanes<LANES>(v, 3, 7, 11, 15, m[schedule[6]], m[schedule[7]]);
+            g_lanes<LANES>(v, 0, 5, 10, 15, m[schedule[8]], m[schedule[9]]);
+            g_lanes<LANES>(v, 1, 6, 11, 12, m[schedule[10]], m[schedule[11]]);
+            g_lanes<LANES>(v, 2, 7, 8, 13, m[schedule[12]], m[schedule[13]]);
+            g_lanes<LANES>(v, 3, 4, 9, 14, m[schedule[14]], m[schedule[15]]);
+        }
+
+        for (size_t i = 0; i < 8; ++i) {
+            cv[i] = v[i] ^ v[i + 8];
+        }
+    }
+
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        for (size_t i = 0; i < 8; ++i) {
+            out[lane][i] = cv[i][lane];
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static void hash_chunks_avx2(const uint8_t* input, const uint64_t chunk_counter, ChainingValue* out) {
+    hash_chunks_lanes<8>(input, chunk_counter, out);
+}
+
+__attribute__((target("avx512f")))
+static void hash_chunks_avx512(const uint8_t* input, const uint64_t chunk_counter, ChainingValue* out) {
+    hash_chunks_lanes<16>(input, chunk_counter, out);
+}
+#endif
+
+// Picks the widest kernel the CPU supports, like histogram_fast does. Returns the number of chunks it hashes at once,
+// 1 when there is none and chunks are hashed one by one.
+using HashChunksKernel = void (*)(const uint8_t*, uint64_t, ChainingValue*);
+
+static std::pair<HashChunksKernel, size_t> detect_hash_chunks_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx512f"))
+        return {hash_chunks_avx512, 16};
+    if (__builtin_cpu_supports("avx2"))
+        return {hash_chunks_avx2, 8};
+#endif
+    return {nullptr, 1};
+}
+
+// The chaining value of a complete subtree of a power of two number of chunks, never the root.
+static ChainingValue subtree_cv(const uint8_t* input, const size_t len, const uint64_t chunk_counter) {
+    static const auto [kernel, kernel_chunks] = detect_hash_chunks_kernel();
+
+    if (len == BLAKE3_CHUNK_LEN)
+        return chunk_cv(input, chunk_counter);
+
+    if (kernel != nullptr && len == kernel_chunks * BLAKE3_CHUNK_LEN) {
+        std::array<ChainingValue, 16> cvs;
+        kernel(input, chunk_counter, cvs.data());
+
+        for (size_t count = kernel_chunks; count > 1; count /= 2) {
+            for (size_t i = 0; i < count / 2; ++i) {
+                cvs[i] = parent_output(cvs[2 * i], cvs[2 * i + 1]).chaining_value();
+            }
+        }
+        return cvs[0];
+    }
+
+    const size_t half = len / 2;
+    const ChainingValue left = subtree_cv(input, half, chunk_counter);
+    const ChainingValue right = subtree_cv(input + half, half, chunk_counter + half / BLAKE3_CHUNK_LEN);
+    return parent_output(left, right).chaining_value();
+}
+
+// The chaining values of the two children of a subtree of at least two chunks. The root of the subtree isn't
+// compressed here since it may be the root of the whole tree. Large subtrees are split into equal pieces that are
+// hashed in parallel and then combined level by level.
+static std::pair<ChainingValue, ChainingValue> subtree_children(const uint8_t* input, const size_t len,
+                                                                const uint64_t chunk_counter) {
+    size_t num_pieces = 2;
+    if (!omp_in_parallel()) {
+        while (num_pieces < PARALLEL_MAX_PIECES && len / (num_pieces * 2) >= PARALLEL_MIN_PIECE_LEN) {
+            num_pieces *= 2;
+        }
+    }
+
+    const size_t piece_len = len / num_pieces;
+    std::vector<ChainingValue> cvs(num_pieces);
+
+    #pragma omp parallel for if(num_pieces > 2)
+    for (size_t i = 0; i < num_pieces; ++i) {
+        cvs[i] = subtree_cv(input + i * piece_len, piece_len, chunk_counter + i * piece_len / BLAKE3_CHUNK_LEN);
+    }
+
+    while (cvs.size() > 2) {
+        std::vector<ChainingValue> parents(cvs.size() / 2);
+        for (size_t i = 0; i < parents.size(); ++i) {
+            parents[i] = parent_output(cvs[2 * i], cvs[2 * i + 1]).chaining_value();
+        }
+        cvs = std::move(parents);
+    }
+
+    return {cvs[0], cvs[1]};
+}
+
+Blake3Hasher::Blake3Hasher() {
+    reset();
+}
+
+void Blake3Hasher::reset() {
+    chunk_init(chunk, 0);
+    cv_stack_len = 0;
+}
+
+// Completed subtrees wait on the stack until a sibling of the same size arrives. After total_chunks chunks there is
+// one entry per set bit of the count, the extra ones are merged into their parents.
+void Blake3Hasher::merge_cv_stack(const uint64_t total_chunks) {
+    const size_t post_merge_stack_len = std::popcount(total_chunks);
+    while (cv_stack_len > post_merge_stack_len) {
+        cv_stack[cv_stack_len - 2] = parent_output(cv_stack[cv_stack_len - 2], cv_stack[cv_stack_len - 1]).chaining_value();
+        cv_stack_len--;
+    }
+}
+
+void Blake3Hasher::push_cv(const ChainingValue& cv, const uint64_t chunk_counter) {
+    merge_cv_stack(chunk_counter);
+    cv_stack[cv_stack_len++] = cv;
+}
+
+void Blake3Hasher::update(std::span<const std::byte> input) {
+    const auto* data = reinterpret_cast<const uint8_t*>(input.data());
+    size_t len = input.size();
+
+    // finish the chunk that is already started, it's only pushed once it's known not to be the last one
+    if (chunk_len(chunk) > 0) {
+        const size_t take = std::min(BLAKE3_CHUNK_LEN - chunk_len(chunk), len);
+        chunk_update(chunk, data, take);
+        data += take;
+        len -= take;
+
+        if (len == 0)
+            return;
+
+        push_cv(chunk_output(chunk).chaining_value(), chunk.chunk_counter);
+        chunk_init(chunk, chunk.chunk_counter + 1);
+    }
+
+    // whole subtrees, as large as the input and their alignment in the tree allow, keeping the last chunk back
+    while (len > BLAKE3_CHUNK_LEN) {
+        size_t subtree_len = std::bit_floor(len);
+        const uint64_t count_so_far = chunk.chunk_counter * BLAKE3_CHUNK_LEN;
+        while (((subtree_len - 1) & count_so_far) != 0) {
+            subtree_len /= 2;
+        }
+        const uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+
+        if (subtree_len <= BLAKE3_CHUNK_LEN) {
+            Blake3ChunkState single;
+            chunk_init(single, chunk.chunk_counter);
+            chunk_update(single, data, subtree_len);
+            push_cv(chunk_output(single).chaining_value(), single.chunk_counter);
+        } else {
+            const auto [left, right] = subtree_children(data, subtree_len, chunk.chunk_counter);
+            push_cv(left, chunk.chunk_counter);
+            push_cv(right, chunk.chunk_counter + subtree_chunks / 2);
+        }
+
+        chunk.chunk_counter += subtree_chunks;
+        data += subtree_len;
+        len -= subtree_len;
+    }
+
+    if (len > 0) {
+        chunk_update(chunk, data, len);
+        merge_cv_stack(chunk.chunk_counter);
+    }
+}
+
+std::array<uint8_t, BLAKE3_OUT_LEN> Blake3Hasher::finalize() const {
+    if (cv_stack_len == 0)
+        return chunk_output(chunk).root_bytes();
+
+    Output output;
+    size_t cvs_remaining;
+    if (chunk_len(chunk) > 0) {
+        cvs_remaining = cv_stack_len;
+        output = chunk_output(chunk);
+    } else {
+        cvs_remaining = cv_stack_len - 2;
+        output = parent_output(cv_stack[cvs_remaining], cv_stack[cvs_remaining + 1]);
+    }
+
+    while (cvs_remaining > 0) {
+        cvs_remaining--;
+        output = parent_output(cv_stack[cvs_remaining], output.chaining_value());
+    }
+
+    return output.root_bytes();
+}
@@ -0,0 +1,53 @@
+#ifndef BLAKE3_H
+#define BLAKE3_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/*
+ * A portable implementation of the BLAKE3 hash function (default hash mode, 32-byte output).
+ *
+ * The input is split into 1 KiB chunks which are hashed independently and combined in a binary tree, so large
+ * inputs are hashed in parallel: a whole subtree passed to update in one call has its chunks spread over the OpenMP
+ * threads, and each thread hashes 16 or 8 chunks at once with an AVX-512 or AVX2 kernel picked at runtime when the
+ * CPU has one.
+ */
+
+constexpr size_t BLAKE3_OUT_LEN = 32;
+constexpr size_t BLAKE3_BLOCK_LEN = 64;
+constexpr size_t BLAKE3_CHUNK_LEN = 1024;
+
+// A chunk that is being hashed, its last block is kept until it's known whether more input follows.
+struct Blake3ChunkState {
+    std::array<uint32_t, 8> cv;
+    uint64_t chunk_counter;
+    std::array<uint8_t, BLAKE3_BLOCK_LEN> block;
+    uint8_t block_len;
+    uint8_t blocks_compressed;
+};
+
+class Blake3Hasher {
+public:
+    Blake3Hasher();
+
+    void reset();
+    void update(std::span<const std::byte> input);
+    std::array<uint8_t, BLAKE3_OUT_LEN> finalize() const;
+
+private:
+    using ChainingValue = std::array<uint32_t, 8>;
+
+    // Enough for 2^54 chunks, the most a 64-bit length can hold
+    static constexpr size_t MAX_DEPTH = 54;
+
+    Blake3ChunkState chunk;
+    std::array<ChainingValue, MAX_DEPTH + 1> cv_stack;
+    uint8_t cv_stack_len;
+
+    void push_cv(const ChainingValue& cv, uint64_t chunk_counter);
+    void merge_cv_stack(uint64_t total_chunks);
+};
+
+#endif // BLAKE3_H
@@ -11,4 +11,12 @@ public:
     Blob(std::string&& hash) : hash(std::move(hash)) {}
 };
 
+// A blob returned from saving file content, created is false when the content was already stored.
+class SavedBlob : public Blob {
+public:
+    const bool created;
+
+    SavedBlob(const std::string& hash, bool created) : Blob(hash), created(created) {}
+};
+
 #endif //BLOB_H
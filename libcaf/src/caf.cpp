@@ -9,120 +9,553 @@
 #include <openssl/evp.h>
 #include <tuple>
 #include <iostream>
-#include <fstream>
 #include <filesystem>
 #include <memory>
-#include <iomanip>
-#include <sstream>
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <span>
+#include <array>
+#include <optional>
+#include <exception>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/mman.h>
 
 #include "caf.h"
-
-constexpr size_t BUFFER_SIZE = 4096;
+#include "huffman/huffman.h"
+#include "blake3/blake3.h"
+#include "object_id.h"
+#include "pack.h"
+#include "util/fd_io.h"
+#include "util/parallel.h"
+
+constexpr size_t HASH_BUFFER_SIZE = 1 << 20;
 constexpr size_t DIR_NAME_SIZE = 2;
+constexpr size_t INGEST_CHUNK_SIZE = 1 << 20; // small enough to still be in cache for the histogram after hashing
 
 std::string create_sub_dir(const std::string& content_root_dir, const std::string& hash);
 void lock_file_with_timeout(int fd, int operation, int timeout_sec);
-void copy_file(const std::string& src, const std::string& dest);
 void create_content_path(const std::string& content_root_dir, const std::string& hash, std::string& output_path);
 
-std::string hash_file(const std::string& filename) {
-    unsigned char hash[EVP_MAX_MD_SIZE];
-    unsigned int hash_len;
+// Hashing many small files or strings is dominated by the per call setup, so each thread keeps one digest context
+// per backend and resets it for every hash instead of allocating a new one, and the OpenSSL digest types are fetched
+// from the provider only once.
+static const EVP_MD* digest_type(const HashAlgorithm algorithm) {
+    static const std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)> sha1(EVP_MD_fetch(nullptr, "SHA1", nullptr), &EVP_MD_free);
+    static const std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)> sha256(EVP_MD_fetch(nullptr, "SHA256", nullptr), &EVP_MD_free);
+
+    const EVP_MD* md = algorithm == HashAlgorithm::SHA256 ? sha256.get() : sha1.get();
+    if (!md)
+        throw std::runtime_error("Failed to fetch digest");
+    return md;
+}
 
-    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+// A hash in progress, with either an OpenSSL context or the BLAKE3 hasher depending on the algorithm.
+struct Digest {
+    HashAlgorithm algorithm;
+    EVP_MD_CTX* mdctx;
+    Blake3Hasher* blake3;
+};
+
+static Digest begin_digest(const HashAlgorithm algorithm) {
+    if (algorithm == HashAlgorithm::BLAKE3) {
+        thread_local Blake3Hasher hasher;
+        hasher.reset();
+        return Digest{algorithm, nullptr, &hasher};
+    }
+
+    thread_local const std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> mdctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
     if (!mdctx){
         throw std::runtime_error("Failed to create EVP_MD_CTX");
     }
 
-    if (EVP_DigestInit_ex(mdctx, EVP_sha1(), nullptr) != 1){
-        EVP_MD_CTX_free(mdctx);
+    if (EVP_DigestInit_ex(mdctx.get(), digest_type(algorithm), nullptr) != 1){
         throw std::runtime_error("Failed to initialize digest");
     }
 
-    std::ifstream file(filename, std::ios::binary);
-    if (!file){
-        EVP_MD_CTX_free(mdctx);
+    return Digest{algorithm, mdctx.get(), nullptr};
+}
+
+static void update_digest(Digest& digest, const void* data, const size_t size) {
+    if (digest.blake3) {
+        digest.blake3->update(std::span<const std::byte>(static_cast<const std::byte*>(data), size));
+        return;
+    }
+
+    if (EVP_DigestUpdate(digest.mdctx, data, size) != 1){
+        throw std::runtime_error("Failed to update digest");
+    }
+}
+
+static std::string finish_digest(Digest& digest) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_len;
+
+    if (digest.blake3) {
+        const std::array<uint8_t, BLAKE3_OUT_LEN> out = digest.blake3->finalize();
+        std::memcpy(hash, out.data(), out.size());
+        hash_len = out.size();
+    } else if (EVP_DigestFinal_ex(digest.mdctx, hash, &hash_len) != 1){
+        throw std::runtime_error("Failed to finalize digest");
+    }
+
+    std::string hex(hash_len * 2, '\0');
+    for (unsigned int i = 0; i < hash_len; ++i) {
+        hex[2 * i] = HEX_DIGITS[hash[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[hash[i] & 0xF];
+    }
+
+    return hex;
+}
+
+std::string hash_file(const std::string& filename, const HashAlgorithm algorithm) {
+    // reused across calls like the digest context, so small files don't pay for allocating it
+    thread_local std::vector<std::byte> buffer(HASH_BUFFER_SIZE);
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0){
         throw std::runtime_error("Failed to open file");
     }
 
-    std::vector<char> buffer(BUFFER_SIZE);
-    while (file.read(buffer.data(), BUFFER_SIZE)) {
-        if (EVP_DigestUpdate(mdctx, buffer.data(), BUFFER_SIZE) != 1){
-            EVP_MD_CTX_free(mdctx);
-            throw std::runtime_error("Failed to update digest");
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    try {
+        Digest digest = begin_digest(algorithm);
+
+        size_t read;
+        do {
+            read = read_full(fd, buffer);
+            update_digest(digest, buffer.data(), read);
+        } while (read == buffer.size());
+
+        close(fd);
+        return finish_digest(digest);
+    } catch (const std::exception& e) {
+        close(fd);
+        throw;
+    }
+}
+
+IngestedFile ingest_file(const std::string& file_path, const HashAlgorithm algorithm) {
+    MappedFile content = MappedFile::open_for_reading(file_path);
+    const std::span<const std::byte> data = content.data();
+
+    std::array<uint64_t, 256> hist = {0};
+
+    Digest digest = begin_digest(algorithm);
+
+    for (size_t offset = 0; offset < data.size(); offset += INGEST_CHUNK_SIZE) {
+        const std::span<const std::byte> chunk = data.subspan(offset, std::min(INGEST_CHUNK_SIZE, data.size() - offset));
+
+        update_digest(digest, chunk.data(), chunk.size());
+
+        const std::array<uint64_t, 256> chunk_hist = histogram_fast(chunk);
+        for (size_t bin = 0; bin < 256; ++bin) {
+            hist[bin] += chunk_hist[bin];
         }
     }
 
-    // Handle the last partial read
-    if (file.gcount() > 0) {
-        if (EVP_DigestUpdate(mdctx, buffer.data(), file.gcount()) != 1){
-            EVP_MD_CTX_free(mdctx);
-            throw std::runtime_error("Failed to update digest");
+    return IngestedFile{finish_digest(digest), hist, std::move(content)};
+}
+
+std::string hash_string(const std::string& content, const HashAlgorithm algorithm) {
+    Digest digest = begin_digest(algorithm);
+    update_digest(digest, content.data(), content.size());
+    return finish_digest(digest);
+}
+
+unsigned int hash_length(const HashAlgorithm algorithm) {
+    if (algorithm == HashAlgorithm::BLAKE3)
+        return BLAKE3_OUT_LEN * 2;
+    return EVP_MD_get_size(digest_type(algorithm)) * 2;
+}
+
+// Objects are written to a temporary file in the content root and renamed into place once their hash is known. A
+// reader never sees a partially written object, and two writers of the same content just replace one identical file
+// with the other, so the destination doesn't need to be locked.
+static int create_temp_object(const std::string& content_root_dir, std::string& temp_path) {
+    temp_path = content_root_dir + "/.ingest-XXXXXX";
+
+    int fd = mkstemp(temp_path.data());
+    if (fd < 0)
+        throw std::runtime_error("Failed to create temporary file");
+
+    if (fchmod(fd, 0644) < 0) {
+        close(fd);
+        unlink(temp_path.c_str());
+        throw std::runtime_error("Failed to set temporary file permissions");
+    }
+
+    return fd;
+}
+
+static std::string hash_span(std::span<const std::byte> data, const HashAlgorithm algorithm) {
+    Digest digest = begin_digest(algorithm);
+    update_digest(digest, data.data(), data.size());
+    return finish_digest(digest);
+}
+
+// Packs never change once written, so the packs of a content root are mapped once per process and only listed again
+// when the pack directory changes, which costs a stat of the directory per lookup instead of listing it. The
+// modification time may not change for packs written in quick succession, so reading an object that is neither in the
+// known packs nor loose makes them be listed again as well. A pack is only replaced by one with the same name when it
+// is written again with the same objects, the inode of its index tells the two apart.
+using PackList = std::vector<std::shared_ptr<const PackFile>>;
+
+struct ContentPacks {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    std::shared_ptr<const PackList> packs;
+};
+
+static std::shared_ptr<const PackList> content_packs(const std::string& content_root_dir, const bool rescan) {
+    static std::mutex packs_mutex;
+    static std::unordered_map<std::string, ContentPacks> packs_by_root;
+
+    struct stat st;
+    if (stat((content_root_dir + "/" + PACK_DIR).c_str(), &st) < 0) {
+        if (errno != ENOENT)
+            throw std::runtime_error("Failed to stat pack directory");
+
+        std::lock_guard<std::mutex> lock(packs_mutex);
+        packs_by_root.erase(content_root_dir);
+        return std::make_shared<const PackList>();
+    }
+
+    std::lock_guard<std::mutex> lock(packs_mutex);
+    auto it = packs_by_root.find(content_root_dir);
+    if (it != packs_by_root.end() && !rescan && it->second.dev == st.st_dev && it->second.ino == st.st_ino &&
+        it->second.mtime.tv_sec == st.st_mtim.tv_sec && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec)
+        return it->second.packs;
+
+    // packs that are still there are kept mapped, unless the directory itself was replaced or the pack was written again
+    std::map<std::string, std::shared_ptr<const PackFile>> known;
+    if (it != packs_by_root.end() && it->second.dev == st.st_dev && it->second.ino == st.st_ino) {
+        for (const auto& pack : *it->second.packs)
+            known.emplace(pack->path(), pack);
+    }
+
+    auto packs = std::make_shared<PackList>();
+    for (const std::string& index_path : list_pack_indexes(content_root_dir)) {
+        auto known_it = known.find(index_path);
+        struct stat index_st;
+        if (known_it != known.end() && stat(index_path.c_str(), &index_st) == 0 &&
+            index_st.st_ino == known_it->second->index_inode()) {
+            packs->push_back(known_it->second);
+            continue;
+        }
+
+        try {
+            packs->push_back(std::make_shared<const PackFile>(PackFile::open(index_path)));
+        } catch (const std::exception& e) {
+            // a pack removed by a repack after it was listed is skipped, one that is there and can't be read isn't
+            if (access(index_path.c_str(), F_OK) == 0)
+                throw;
         }
     }
 
-    if (EVP_DigestFinal_ex(mdctx, hash, &hash_len) != 1){
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("Failed to finalize digest");
+    packs_by_root[content_root_dir] = ContentPacks{st.st_dev, st.st_ino, st.st_mtim, packs};
+    return packs;
+}
+
+// A packed object, holding on to the packs keeps its data mapped.
+struct PackedContent {
+    std::shared_ptr<const PackList> packs;
+    std::span<const std::byte> data;
+};
+
+static std::optional<PackedContent> find_packed_content(const std::string& content_root_dir, const std::string& hash,
+                                                        const bool rescan) {
+    std::optional<ObjectId> id = ObjectId::from_hex(hash);
+    if (!id)
+        return std::nullopt;
+
+    std::shared_ptr<const PackList> packs = content_packs(content_root_dir, rescan);
+    for (const auto& pack : *packs) {
+        if (std::optional<std::span<const std::byte>> data = pack->find(*id))
+            return PackedContent{packs, *data};
     }
 
-    EVP_MD_CTX_free(mdctx);
+    return std::nullopt;
+}
 
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (unsigned int i = 0; i < hash_len; ++i) {
-        oss << std::setw(2) << static_cast<unsigned int>(hash[i]);
+// Decompresses a stored huffman file into an unlinked temporary file, it goes away with the last descriptor.
+static int decompress_content(const std::string& content_root_dir, const std::string& content_path) {
+    std::string temp_path = content_root_dir + "/.decompress-XXXXXX";
+    int temp_fd = mkstemp(temp_path.data());
+    if (temp_fd < 0)
+        throw std::runtime_error("Failed to create temporary file");
+
+    try {
+        huffman_decode_file(content_path, temp_path);
+    } catch (const std::exception& e) {
+        unlink(temp_path.c_str());
+        close(temp_fd);
+        throw;
     }
 
-    return oss.str();
+    unlink(temp_path.c_str());
+    return temp_fd;
 }
 
-std::string hash_string(const std::string& content) {
-    EVP_MD_CTX* mdctx = EVP_MD_CTX_new();
-    if (mdctx == nullptr) {
-        throw std::runtime_error("Failed to create EVP_MD_CTX");
+// Where the loose object of a hash is, unlike create_content_path it doesn't create the sub directory, so looking for
+// an object that is only packed doesn't bring back the directories a repack removed.
+static std::string loose_content_path(const std::string& content_root_dir, const std::string& hash) {
+    if (content_root_dir.empty() || hash.length() < 2)
+        throw std::invalid_argument("Invalid argument");
+
+    return content_root_dir + "/" + hash.substr(0, 2) + "/" + hash;
+}
+
+// Rewrites the packs holding an object without it. A loose copy written to replace a damaged packed object is only
+// read once the packed one is gone, since the packs are looked at first. The rewritten pack is moved into place before
+// the old one is removed, so the other objects stay readable throughout.
+static void remove_packed_content(const std::string& content_root_dir, const ObjectId& id) {
+    std::shared_ptr<const PackList> packs = content_packs(content_root_dir, true);
+
+    for (const auto& pack : *packs) {
+        if (!pack->find(id))
+            continue;
+
+        if (pack->size() > 1) {
+            PackWriter writer(content_root_dir);
+            for (size_t i = 0; i < pack->size(); ++i) {
+                if (pack->id(i) != id)
+                    writer.add(pack->id(i), pack->object(i));
+            }
+            writer.finish();
+        }
+
+        // the index goes first so no reader finds a pack without its objects
+        unlink(pack->path().c_str());
+        unlink(pack_path_for_index(pack->path()).c_str());
     }
 
-    const EVP_MD* md = EVP_sha1();
-    if (EVP_DigestInit_ex(mdctx, md, nullptr) != 1) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("Failed to initialize digest");
+    content_packs(content_root_dir, true);
+}
+
+// Saved blobs start with a HuffmanFileTag naming their codec (see save_file_content). Objects without one hold their
+// content as is, they were saved before blobs were tagged or written through open_content_for_writing.
+enum class ContentCodec {
+    UNTAGGED,
+    RAW,     // the stored layout, the content follows a header of HUFFMAN_STORED_HEADER_SIZE bytes
+    HUFFMAN, // any other huffman file
+};
+
+// head is the start of an object of object_size bytes, HUFFMAN_STORED_HEADER_SIZE bytes of it unless it's shorter.
+static ContentCodec content_codec(std::span<const std::byte> head, const uint64_t object_size) {
+    HuffmanFileTag tag;
+    if (head.size() < sizeof(tag))
+        return ContentCodec::UNTAGGED;
+
+    std::memcpy(&tag, head.data(), sizeof(tag));
+    if (tag.magic != HUFFMAN_MAGIC)
+        return ContentCodec::UNTAGGED;
+    if (tag.version != static_cast<uint8_t>(HuffmanFormat::STORED))
+        return ContentCodec::HUFFMAN;
+
+    uint64_t content_size;
+    if (head.size() < HUFFMAN_STORED_HEADER_SIZE)
+        throw std::runtime_error("Object too small to contain header");
+    std::memcpy(&content_size, head.data() + sizeof(tag), sizeof(content_size));
+    if (object_size - HUFFMAN_STORED_HEADER_SIZE != content_size)
+        throw std::runtime_error("Stored data size does not match its header");
+
+    return ContentCodec::RAW;
+}
+
+// Reads the head of an open object, the descriptor is left past it
+static ContentCodec read_content_codec(const int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        throw std::runtime_error("Failed to stat object");
+
+    std::array<std::byte, HUFFMAN_STORED_HEADER_SIZE> head;
+    const size_t read = read_full(fd, head);
+    return content_codec(std::span<const std::byte>(head.data(), read), st.st_size);
+}
+
+static std::array<std::byte, HUFFMAN_STORED_HEADER_SIZE> raw_content_header(const uint64_t content_size) {
+    const HuffmanFileTag tag = {HUFFMAN_MAGIC, static_cast<uint8_t>(HuffmanFormat::STORED)};
+
+    std::array<std::byte, HUFFMAN_STORED_HEADER_SIZE> header;
+    std::memcpy(header.data(), &tag, sizeof(tag));
+    std::memcpy(header.data() + sizeof(tag), &content_size, sizeof(content_size));
+    return header;
+}
+
+// Packed content is handed out like loose content, as the descriptor of a file holding it that goes away when closed.
+static int open_packed_content(const std::string& content_root_dir, const PackedContent& packed) {
+    std::span<const std::byte> data = packed.data;
+    const ContentCodec codec = content_codec(data.first(std::min(data.size(), HUFFMAN_STORED_HEADER_SIZE)), data.size());
+    if (codec == ContentCodec::RAW)
+        data = data.subspan(HUFFMAN_STORED_HEADER_SIZE);
+
+    if (codec == ContentCodec::HUFFMAN) {
+        // the decoder reads files, so the object is copied out of the pack first
+        std::string temp_path;
+        int temp_fd = create_temp_object(content_root_dir, temp_path);
+
+        int fd = -1;
+        try {
+            write_full(temp_fd, packed.data);
+            fd = decompress_content(content_root_dir, temp_path);
+        } catch (const std::exception& e) {
+            close(temp_fd);
+            unlink(temp_path.c_str());
+            throw;
+        }
+
+        close(temp_fd);
+        unlink(temp_path.c_str());
+        return fd;
     }
 
-    if (EVP_DigestUpdate(mdctx, content.c_str(), content.size()) != 1) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("Failed to update digest");
+    int fd = memfd_create("caf-content", 0);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create temporary file");
+
+    try {
+        write_full(fd, data);
+        if (lseek(fd, 0, SEEK_SET) < 0)
+            throw std::runtime_error("Failed to rewind temporary file");
+    } catch (const std::exception& e) {
+        close(fd);
+        throw;
     }
 
-    // Get the actual hash size from OpenSSL
-    int hash_size = EVP_MD_size(md);
-    std::vector<unsigned char> hash(hash_size);
-    unsigned int hash_len;
+    return fd;
+}
 
-    if (EVP_DigestFinal_ex(mdctx, hash.data(), &hash_len) != 1) {
-        EVP_MD_CTX_free(mdctx);
-        throw std::runtime_error("Failed to finalize digest");
+// Compares a stored object with the content it should hold, decompressing it first when it's compressed.
+static bool stored_content_matches(const std::string& content_root_dir, const std::string& hash,
+                                   std::span<const std::byte> data) {
+    int fd = open_content_for_reading(content_root_dir, hash);
+
+    std::vector<std::byte> buffer(INGEST_CHUNK_SIZE);
+    size_t offset = 0;
+    bool matches = true;
+    try {
+        while (matches) {
+            const size_t read = read_full(fd, buffer);
+            if (read == 0)
+                break;
+
+            matches = read <= data.size() - offset &&
+                      std::memcmp(buffer.data(), data.data() + offset, read) == 0;
+            offset += read;
+        }
+    } catch (const std::exception& e) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        throw;
     }
 
-    EVP_MD_CTX_free(mdctx);
+    flock(fd, LOCK_UN);
+    close(fd);
 
-    std::ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    for (unsigned int i = 0; i < hash_len; ++i) {
-        oss << std::setw(2) << static_cast<unsigned int>(hash[i]);
+    return matches && offset == data.size();
+}
+
+static ContentCodec stored_content_codec(const std::string& content_root_dir, const std::string& hash,
+                                        const std::optional<PackedContent>& packed) {
+    if (packed)
+        return content_codec(packed->data.first(std::min(packed->data.size(), HUFFMAN_STORED_HEADER_SIZE)),
+                             packed->data.size());
+
+    int fd = open(loose_content_path(content_root_dir, hash).c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open file");
+
+    ContentCodec codec;
+    try {
+        codec = read_content_codec(fd);
+    } catch (const std::exception& e) {
+        close(fd);
+        throw;
     }
 
-    return oss.str();
+    close(fd);
+    return codec;
 }
 
-unsigned int hash_length() {
-    return EVP_MD_size(EVP_sha1()) * 2;
+// Content that is already stored is only checked for, not written again, whichever codec it was stored with. A raw
+// object of the right size, tagged or not, is taken to hold the content. Any other size is either a compressed object,
+// which only has to exist since its size says nothing about the content's, or a damaged raw one, and the codec tag
+// tells them apart. With verify set the stored bytes are compared with the content instead, and an object that doesn't
+// match is replaced.
+static bool content_is_stored(const std::string& content_root_dir, const std::string& hash,
+                              std::span<const std::byte> data, const bool verify) {
+    std::optional<PackedContent> packed = find_packed_content(content_root_dir, hash, false);
+
+    size_t stored_size;
+    if (packed) {
+        stored_size = packed->data.size();
+    } else {
+        const std::string content_path = loose_content_path(content_root_dir, hash);
+
+        struct stat st;
+        if (stat(content_path.c_str(), &st) < 0) {
+            if (errno == ENOENT)
+                return false;
+            throw std::runtime_error("Failed to stat file");
+        }
+        stored_size = st.st_size;
+    }
+
+    // an object that can't be read back, e.g. a damaged huffman file, is replaced like a mismatching one
+    try {
+        if (verify)
+            return stored_content_matches(content_root_dir, hash, data);
+
+        if (stored_size == HUFFMAN_STORED_HEADER_SIZE + data.size() || stored_size == data.size())
+            return true;
+
+        return stored_content_codec(content_root_dir, hash, packed) == ContentCodec::HUFFMAN;
+    } catch (const std::exception& e) {
+        return false;
+    }
 }
 
-Blob save_file_content(const std::string& content_root_dir, const std::string& file_path) {
+// Raw content is copied from the source file after its header rather than written from the mapping, so the kernel or
+// the filesystem copies it without going through user space. The copy goes through the descriptor that was mapped
+// and hashed, and when the file's size or modification time changed meanwhile the copy may not match the hash, so the
+// object is rewritten from the mapping instead.
+static void copy_content(const MappedFile& mapped, const int fd) {
+    const std::array<std::byte, HUFFMAN_STORED_HEADER_SIZE> header = raw_content_header(mapped.size());
+    write_full(fd, header);
+
+    if (lseek(mapped.fd(), 0, SEEK_SET) < 0)
+        throw std::runtime_error("Failed to seek file");
+
+    copy_fd(mapped.fd(), fd);
+
+    struct stat after;
+    if (fstat(mapped.fd(), &after) < 0)
+        throw std::runtime_error("Failed to stat file");
+
+    const struct stat& before = mapped.file_stat();
+    if (after.st_size == before.st_size && after.st_mtim.tv_sec == before.st_mtim.tv_sec &&
+        after.st_mtim.tv_nsec == before.st_mtim.tv_nsec)
+        return;
+
+    if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0)
+        throw std::runtime_error("Failed to truncate file");
+
+    write_full(fd, header);
+    write_full(fd, mapped.data());
+}
+
+SavedBlob save_file_content(const std::string& content_root_dir, const std::string& file_path, const bool compress,
+                            const bool verify, const HashAlgorithm algorithm) {
     std::error_code ec;
     std::filesystem::create_directories(content_root_dir, ec);
     if (ec && ec != std::errc::file_exists) {
@@ -134,40 +567,82 @@ Blob save_file_content(const std::string& content_root_dir, const std::string& f
         std::filesystem::perms::owner_all | std::filesystem::perms::group_read |
         std::filesystem::perms::others_read, ec);
 
-    std::string file_hash = hash_file(file_path);
+    // the encoder needs the whole histogram up front, raw content only needs the hash before checking whether it's
+    // already stored
+    std::optional<IngestedFile> ingested;
+    std::optional<MappedFile> mapped;
+    std::span<const std::byte> data;
+    std::string hash;
+    if (compress) {
+        ingested.emplace(ingest_file(file_path, algorithm));
+        data = ingested->content.data();
+        hash = ingested->hash;
+    } else {
+        mapped.emplace(MappedFile::open_for_reading(file_path));
+        data = mapped->data();
+        hash = hash_span(data, algorithm);
+    }
 
-    std::string content_path;
-    create_content_path(content_root_dir, file_hash, content_path);
+    if (content_is_stored(content_root_dir, hash, data, verify))
+        return SavedBlob(hash, false);
 
-    int fd = open(content_path.c_str(), O_WRONLY | O_CREAT, 0644);
+    std::string temp_path;
+    int fd = create_temp_object(content_root_dir, temp_path);
 
-    if (fd < 0)
-        throw std::runtime_error("Failed to open file");
+    try {
+        if (compress)
+            huffman_encode_span_to_file_compact(data, ingested->histogram, temp_path, MAX_CODE_LEN, true);
+        else
+            copy_content(*mapped, fd);
 
-    try{
-        lock_file_with_timeout(fd, LOCK_EX, 10);
-    } catch (const std::exception& e){
-        close(fd);
-        throw;
-    }
+        std::string content_path;
+        create_content_path(content_root_dir, hash, content_path);
 
-    try {
-        copy_file(file_path, content_path);
+        if (rename(temp_path.c_str(), content_path.c_str()) < 0)
+            throw std::runtime_error("Failed to move file into place");
     } catch (const std::exception& e) {
-        std::error_code ec;
-        std::filesystem::remove(content_path, ec);
-        flock(fd, LOCK_UN);
+        unlink(temp_path.c_str());
         close(fd);
         throw;
     }
 
-    flock(fd, LOCK_UN);
     close(fd);
 
-    return Blob(file_hash);
+    // a packed object that was saved again didn't match, e.g. it was damaged, so it's dropped for the new copy
+    if (find_packed_content(content_root_dir, hash, false))
+        remove_packed_content(content_root_dir, *ObjectId::from_hex(hash));
+
+    return SavedBlob(hash, true);
 }
 
-int open_content_for_writing(const std::string& content_root_dir, const std::string& content_hash) {
+std::vector<std::string> hash_files(const std::vector<std::string>& file_paths, const HashAlgorithm algorithm) {
+    std::vector<std::string> hashes(file_paths.size());
+
+    parallel_for_each_index(file_paths.size(), [&](const size_t i) {
+        hashes[i] = hash_file(file_paths[i], algorithm);
+    });
+
+    return hashes;
+}
+
+std::vector<SavedBlob> save_files_content(const std::string& content_root_dir, const std::vector<std::string>& file_paths,
+                                          const bool compress, const bool verify, const HashAlgorithm algorithm) {
+    std::vector<std::optional<SavedBlob>> saved(file_paths.size());
+
+    parallel_for_each_index(file_paths.size(), [&](const size_t i) {
+        saved[i].emplace(save_file_content(content_root_dir, file_paths[i], compress, verify, algorithm));
+    });
+
+    std::vector<SavedBlob> blobs;
+    blobs.reserve(saved.size());
+    for (auto& blob : saved) {
+        blobs.push_back(std::move(*blob));
+    }
+
+    return blobs;
+}
+
+static void create_content_root(const std::string& content_root_dir) {
     std::error_code ec;
     std::filesystem::create_directories(content_root_dir, ec);
     if (ec && ec != std::errc::file_exists) {
@@ -179,6 +654,10 @@ int open_content_for_writing(const std::string& content_root_dir, const std::str
         std::filesystem::perms::owner_all |
         std::filesystem::perms::group_read | std::filesystem::perms::group_exec |
         std::filesystem::perms::others_read | std::filesystem::perms::others_exec, ec);
+}
+
+int open_content_for_writing(const std::string& content_root_dir, const std::string& content_hash) {
+    create_content_root(content_root_dir);
 
     std::string content_path;
     create_content_path(content_root_dir, content_hash, content_path);
@@ -199,9 +678,35 @@ int open_content_for_writing(const std::string& content_root_dir, const std::str
     return fd;
 }
 
+void save_content(const std::string& content_root_dir, const std::string& content_hash,
+                  std::span<const std::byte> data) {
+    if (find_packed_content(content_root_dir, content_hash, false))
+        return;
+
+    create_content_root(content_root_dir);
+
+    std::string temp_path;
+    int fd = create_temp_object(content_root_dir, temp_path);
+
+    try {
+        write_full(fd, data);
+
+        std::string content_path;
+        create_content_path(content_root_dir, content_hash, content_path);
+
+        if (rename(temp_path.c_str(), content_path.c_str()) < 0)
+            throw std::runtime_error("Failed to move file into place");
+    } catch (const std::exception& e) {
+        unlink(temp_path.c_str());
+        close(fd);
+        throw;
+    }
+
+    close(fd);
+}
+
 void delete_content(const std::string& content_root_dir, const std::string& content_hash) {
-    std::string content_path;
-    create_content_path(content_root_dir, content_hash, content_path);
+    const std::string content_path = loose_content_path(content_root_dir, content_hash);
 
     int fd = open(content_path.c_str(), O_RDONLY);
     if (fd < 0)
@@ -230,62 +735,229 @@ void delete_content(const std::string& content_root_dir, const std::string& cont
 }
 
 int open_content_for_reading(const std::string& content_root_dir, const std::string& content_hash) {
-    std::string content_path;
-    create_content_path(content_root_dir, content_hash, content_path);
+    std::optional<PackedContent> packed = find_packed_content(content_root_dir, content_hash, false);
+    if (packed)
+        return open_packed_content(content_root_dir, *packed);
+
+    const std::string content_path = loose_content_path(content_root_dir, content_hash);
 
     int fd = open(content_path.c_str(), O_RDONLY);
 
-    if (fd < 0)
+    if (fd < 0) {
+        // the object may have been packed since the packs were listed
+        if (errno == ENOENT && (packed = find_packed_content(content_root_dir, content_hash, true)))
+            return open_packed_content(content_root_dir, *packed);
         throw std::runtime_error("Failed to open file");
+    }
 
     try{
-        lock_file_with_timeout(fd, LOCK_EX, 10);
+        lock_file_with_timeout(fd, LOCK_SH, 10);
     } catch (const std::exception& e){
         close(fd);
         throw;
     }
 
-    return fd;
+    ContentCodec codec;
+    try {
+        codec = read_content_codec(fd);
+        if (codec == ContentCodec::UNTAGGED && lseek(fd, 0, SEEK_SET) < 0)
+            throw std::runtime_error("Failed to seek file");
+    } catch (const std::exception& e) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        throw;
+    }
+
+    // a raw object is read from after its header
+    if (codec != ContentCodec::HUFFMAN)
+        return fd;
+
+    int temp_fd;
+    try {
+        temp_fd = decompress_content(content_root_dir, content_path);
+    } catch (const std::exception& e) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        throw;
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    return temp_fd;
 }
 
-void copy_file(const std::string& src, const std::string& dest) {
-    std::ifstream source_file(src, std::ios::binary);
-    if (!source_file) {
-        throw std::runtime_error("Failed to open source file");
+std::vector<std::byte> read_content(const std::string& content_root_dir, const std::string& content_hash) {
+    std::optional<PackedContent> packed = find_packed_content(content_root_dir, content_hash, false);
+    if (packed)
+        return std::vector<std::byte>(packed->data.begin(), packed->data.end());
+
+    // the loose file is read as is, open_content_for_reading would decode it
+    int fd = open(loose_content_path(content_root_dir, content_hash).c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT && (packed = find_packed_content(content_root_dir, content_hash, true)))
+            return std::vector<std::byte>(packed->data.begin(), packed->data.end());
+        throw std::runtime_error("Failed to open file");
     }
 
-    std::ofstream dest_file(dest, std::ios::binary);
-    if (!dest_file) {
-        throw std::runtime_error("Failed to open destination file");
+    std::vector<std::byte> data;
+    try {
+        lock_file_with_timeout(fd, LOCK_SH, 10);
+
+        struct stat st;
+        if (fstat(fd, &st) < 0)
+            throw std::runtime_error("Failed to stat object");
+
+        data.resize(st.st_size);
+        data.resize(read_full(fd, data));
+    } catch (const std::exception& e) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        throw;
     }
 
-    std::vector<char> buffer(BUFFER_SIZE);
-    while (source_file.read(buffer.data(), BUFFER_SIZE)) {
-        if (!dest_file.write(buffer.data(), BUFFER_SIZE)) {
-            throw std::runtime_error("Failed to write to destination file");
-        }
+    flock(fd, LOCK_UN);
+    close(fd);
 
-        if (dest_file.fail()) {
-            throw std::runtime_error("Error while writing to destination file");
-        }
+    return data;
+}
+
+// open_content_for_writing creates an object before it locks it, so a loose object that is locked, or empty without
+// being the object of no content, may still be written. Packing it would keep a partial copy and delete the object, so
+// it's left for the next repack. Returns whether the object is complete, locking it for reading when it isn't being
+// written.
+static bool lock_complete_object(const int fd, const std::string& hash) {
+    if (flock(fd, LOCK_SH | LOCK_NB) < 0) {
+        if (errno == EWOULDBLOCK)
+            return false;
+        throw std::runtime_error("Failed to acquire lock");
     }
 
-    // Handle the last partial read
-    if (source_file.gcount() > 0) {
-        if (!dest_file.write(buffer.data(), source_file.gcount())) {
-            throw std::runtime_error("Failed to write to destination file");
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        throw std::runtime_error("Failed to stat file");
+    if (st.st_size > 0)
+        return true;
+
+    for (const HashAlgorithm algorithm : {HashAlgorithm::SHA1, HashAlgorithm::SHA256, HashAlgorithm::BLAKE3}) {
+        if (hash == hash_span({}, algorithm))
+            return true;
+    }
+    return false;
+}
+
+size_t repack_content(const std::string& content_root_dir) {
+    std::shared_ptr<const PackList> packs = content_packs(content_root_dir, true);
+
+    // the ids of a pack all have the same size, so objects of different hash algorithms go to different packs
+    std::map<size_t, PackWriter> writers;
+    const auto writer_for = [&](const ObjectId& id) -> PackWriter& {
+        auto it = writers.find(id.size());
+        if (it == writers.end())
+            it = writers.emplace(id.size(), PackWriter(content_root_dir)).first;
+        return it->second;
+    };
+
+    std::unordered_set<ObjectId> packed_ids;
+    std::vector<std::string> loose_hashes;
+    std::vector<std::string> sub_dirs;
+
+    for (const auto& sub_dir : std::filesystem::directory_iterator(content_root_dir)) {
+        if (!sub_dir.is_directory() || sub_dir.path().filename().string().size() != DIR_NAME_SIZE)
+            continue;
+        sub_dirs.push_back(sub_dir.path().string());
+
+        for (const auto& file : std::filesystem::directory_iterator(sub_dir)) {
+            std::string hash = file.path().filename().string();
+            std::optional<ObjectId> id = ObjectId::from_hex(hash);
+            if (!id)
+                continue;
+
+            if (!packed_ids.contains(*id)) {
+                int fd = open(file.path().c_str(), O_RDONLY);
+                if (fd < 0)
+                    throw std::runtime_error("Failed to open file");
+
+                bool complete;
+                try {
+                    complete = lock_complete_object(fd, hash);
+                    if (complete)
+                        writer_for(*id).add(*id, fd);
+                } catch (const std::exception& e) {
+                    flock(fd, LOCK_UN);
+                    close(fd);
+                    throw;
+                }
+
+                flock(fd, LOCK_UN);
+                close(fd);
+
+                // left loose for the next repack
+                if (!complete)
+                    continue;
+                packed_ids.insert(*id);
+            }
+            loose_hashes.push_back(std::move(hash));
         }
+    }
 
-        if (dest_file.fail()) {
-            throw std::runtime_error("Error while writing to destination file");
+    for (const auto& pack : *packs) {
+        for (size_t i = 0; i < pack->size(); ++i) {
+            ObjectId id = pack->id(i);
+            if (packed_ids.insert(id).second)
+                writer_for(id).add(id, pack->object(i));
         }
     }
 
-    // Explicit flush to ensure all data is written
-    dest_file.flush();
-    if (dest_file.fail()) {
-        throw std::runtime_error("Failed to flush destination file");
+    std::set<std::string> new_indexes;
+    for (auto& [id_size, writer] : writers)
+        new_indexes.insert(writer.finish());
+
+    // everything is in the new packs now, the index goes first so no reader finds a pack without its objects
+    for (const auto& pack : *packs) {
+        if (new_indexes.contains(pack->path()))
+            continue;
+        unlink(pack->path().c_str());
+        unlink(pack_path_for_index(pack->path()).c_str());
     }
+
+    for (const std::string& hash : loose_hashes)
+        delete_content(content_root_dir, hash);
+    for (const std::string& sub_dir : sub_dirs)
+        rmdir(sub_dir.c_str()); // only removes the ones left empty
+
+    content_packs(content_root_dir, true);
+
+    return packed_ids.size();
+}
+
+CopyMethod copy_file(const std::string& src, const std::string& dest) {
+    int in_fd = open(src.c_str(), O_RDONLY);
+    if (in_fd < 0) {
+        throw std::runtime_error("Failed to open source file");
+    }
+
+    int out_fd = open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        close(in_fd);
+        throw std::runtime_error("Failed to open destination file");
+    }
+
+    CopyMethod method;
+    try {
+        method = copy_fd(in_fd, out_fd);
+    } catch (const std::exception& e) {
+        close(in_fd);
+        close(out_fd);
+        throw;
+    }
+
+    close(in_fd);
+    if (close(out_fd) < 0) {
+        throw std::runtime_error("Failed to close destination file");
+    }
+
+    return method;
 }
 
 void create_content_path(const std::string& content_root_dir, const std::string& hash, std::string& output_path) {
@@ -316,18 +988,27 @@ std::string create_sub_dir(const std::string& content_root_dir, const std::strin
     return sub_dir_path;
 }
 
+// flock can't wait with a timeout, so the lock is retried with an exponential backoff that starts short enough for
+// the common case of a lock held for a single small read or write and is capped so a long wait still notices the lock
+// being released soon after.
 void lock_file_with_timeout(int fd, int operation, int timeout_sec){
-    auto start_time = std::chrono::steady_clock::now();
-    auto timeout_duration = std::chrono::seconds(timeout_sec);
+    constexpr auto MIN_BACKOFF = std::chrono::microseconds(10);
+    constexpr auto MAX_BACKOFF = std::chrono::microseconds(10000);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec);
+    auto backoff = MIN_BACKOFF;
 
     while (flock(fd, operation | LOCK_NB) != 0) {
-        if (errno == EWOULDBLOCK) {
-            auto elapsed = std::chrono::steady_clock::now() - start_time;
-            if (elapsed >= timeout_duration)
-                throw std::runtime_error("Failed to acquire lock");
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
-        else
+        if (errno == EINTR)
+            continue;
+        if (errno != EWOULDBLOCK)
+            throw std::runtime_error("Failed to acquire lock");
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
             throw std::runtime_error("Failed to acquire lock");
+
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(backoff, deadline - now));
+        backoff = std::min(backoff * 2, MAX_BACKOFF);
     }
 }
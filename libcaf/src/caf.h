@@ -4,18 +4,74 @@
 #include <unistd.h>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <vector>
 
 #include "blob.h"
+#include "hash_algorithm.h"
+#include "util/mapped_file.h"
+#include "util/fd_io.h"
 
-unsigned int hash_length();
+unsigned int hash_length(const HashAlgorithm algorithm = HashAlgorithm::SHA1);
 
-std::string hash_file(const std::string& file_path);
-std::string hash_string(const std::string& content);
+std::string hash_file(const std::string& file_path, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+std::string hash_string(const std::string& content, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
 
-Blob save_file_content(const std::string& content_root_dir, const std::string& file_path);
+// A file read once for ingestion: its hash and byte histogram are computed in the same pass over each chunk, and the
+// mapping stays open so storing or compressing the content doesn't read the file again.
+struct IngestedFile {
+    std::string hash;
+    std::array<uint64_t, 256> histogram;
+    MappedFile content;
+};
+IngestedFile ingest_file(const std::string& file_path, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+
+// Every saved blob starts with a HuffmanFileTag whose version records its codec. Raw content is stored in the stored
+// format, the content after a small header, and compressed content in the compact format, or in the stored format
+// when it doesn't shrink. compress only picks the codec of new objects, so raw and compressed objects can be mixed in
+// one content root.
+// Saved content is written to a temporary file in the content root and renamed into place, so a saved object is
+// always complete. Content that is already stored costs a stat, or a comparison with the stored object when verify is
+// set, and the returned blob tells whether a new object was created.
+SavedBlob save_file_content(const std::string& content_root_dir, const std::string& file_path, const bool compress = false,
+                            const bool verify = false, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+
+// Batch versions of hash_file and save_file_content that process the files in parallel, the results are in the order
+// of file_paths.
+std::vector<std::string> hash_files(const std::vector<std::string>& file_paths,
+                                    const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+std::vector<SavedBlob> save_files_content(const std::string& content_root_dir, const std::vector<std::string>& file_paths,
+                                          const bool compress = false, const bool verify = false,
+                                          const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+
+// The descriptors are returned locked, shared for reading so readers of the same object don't wait for each other and
+// exclusive for writing. Either waits up to 10 seconds for the lock.
+// Reading detects the codec of the object and returns a descriptor positioned at its content, decompressed when it's
+// compressed. Objects without a codec tag, e.g. written through open_content_for_writing, are read as they are.
+// Packed objects are looked up before loose ones. Saving content with verify set replaces a damaged packed object by
+// writing a loose copy and rewriting its pack without it.
 int open_content_for_reading(const std::string& content_root_dir, const std::string& content_hash);
 int open_content_for_writing(const std::string& content_root_dir, const std::string& content_hash);
 
+// Stores data as the object content_hash through a temporary file renamed into place, like saved content. An object
+// that is already packed isn't written again.
+void save_content(const std::string& content_root_dir, const std::string& content_hash, std::span<const std::byte> data);
+
+// Reads a whole stored object as it's stored, codec tag included, compressed content isn't decompressed.
+std::vector<std::byte> read_content(const std::string& content_root_dir, const std::string& content_hash);
+
+// Only deletes the loose object, packs are never changed. An object that is also packed stays readable from its pack,
+// and deleting one that is only packed does nothing.
 void delete_content(const std::string& content_root_dir, const std::string& content_hash);
 
+// Moves every loose object and the objects of the existing packs into a new pack (see pack.h) and removes them from
+// where they were. Loose objects still being written through open_content_for_writing are left loose. Returns the
+// number of objects packed.
+size_t repack_content(const std::string& content_root_dir);
+
+// Copies a file with the cheapest method the filesystem supports (see copy_fd) and returns the one it used.
+CopyMethod copy_file(const std::string& src, const std::string& dest);
+
 #endif // CAF_H
\ No newline at end of file
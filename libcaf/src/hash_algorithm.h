@@ -0,0 +1,12 @@
+#ifndef HASH_ALGORITHM_H
+#define HASH_ALGORITHM_H
+
+// The digest used for object hashes. It is chosen per repository, every hash of a repository has to use the same
+// one since the hash is the object's name. SHA-1 is the default so existing repositories keep their object names.
+enum class HashAlgorithm {
+    SHA1,
+    SHA256,
+    BLAKE3
+};
+
+#endif // HASH_ALGORITHM_H
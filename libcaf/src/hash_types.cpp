@@ -5,17 +5,17 @@ std::string hash_object(const Blob& blob) {
     return blob.hash;
 }
 
-std::string hash_object(const Tree& tree) {
+std::string hash_object(const Tree& tree, const HashAlgorithm algorithm) {
     std::string acc_std;
 
     for (const auto& [key, record] : tree.records) {
-        acc_std += record.name + std::to_string(static_cast<int>(record.type)) + record.hash;
+        acc_std += record.name + std::to_string(static_cast<int>(record.type)) + record.hash.to_hex();
     }
 
-    return hash_string(acc_std);
+    return hash_string(acc_std, algorithm);
 }
 
-std::string hash_object(const Commit& commit) {
-    return hash_string(commit.tree_hash + commit.author + commit.message +
-                       std::to_string(commit.timestamp) + commit.parent.value_or(""));
+std::string hash_object(const Commit& commit, const HashAlgorithm algorithm) {
+    return hash_string(commit.tree_hash.to_hex() + commit.author + commit.message + std::to_string(commit.timestamp) +
+                       (commit.parent ? commit.parent->to_hex() : ""), algorithm);
 }
\ No newline at end of file
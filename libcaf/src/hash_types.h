@@ -7,9 +7,10 @@
 #include "tree_record.h"
 #include "tree.h"
 #include "commit.h"
+#include "hash_algorithm.h"
 
 std::string hash_object(const Blob& blob);
-std::string hash_object(const Tree& tree);
-std::string hash_object(const Commit& commit);
+std::string hash_object(const Tree& tree, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+std::string hash_object(const Commit& commit, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
 
 #endif // HASHTYPES_H
\ No newline at end of file
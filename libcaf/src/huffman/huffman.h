@@ -11,31 +11,145 @@
 #include <unordered_map>    // for std::unordered_map
 #include <string>           // for std::string
 
-#define MAX_CODE_LEN 9 // there can be 511 possible codes so 9 bits are needed to represent them
+// Upper bound on the length of a code produced by huffman_code_lengths, and thus on the width of the decode table.
+// An unconstrained huffman tree over 256 symbols can be up to 255 levels deep, so this must be enforced when the
+// code lengths are built, not assumed by the decoder.
+#define MAX_CODE_LEN 12
 
 // huffman_histogram.cpp
 std::array<uint64_t, 256> histogram(std::span<const std::byte> data);
 std::array<uint64_t, 256> histogram_parallel(std::span<const std::byte> data);
 std::array<uint64_t, 256> histogram_parallel_64bit(std::span<const std::byte> data);
 std::array<uint64_t, 256> histogram_fast(std::span<const std::byte> data);
+std::array<uint64_t, 256> histogram_subtables(std::span<const std::byte> data);
 
 // huffman_tree.cpp
 std::vector<HuffmanNode> huffman_tree(const std::array<uint64_t, 256>& hist);
+std::array<uint16_t, 256> huffman_code_lengths(const std::array<uint64_t, 256>& hist, const size_t max_code_len = MAX_CODE_LEN);
 
 // huffman_dict.cpp
+
+// Packed form of a huffman code used by the encoders and decoders, the std::vector<bool> dictionaries are only kept
+// for the python bindings. The code is right-aligned in `code` and its most significant bit is emitted first.
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t len;
+};
+using HuffmanCodeTable = std::array<HuffmanCode, 256>;
+
 std::array<std::vector<bool>, 256> huffman_dict(const std::vector<HuffmanNode>& nodes);
 void canonicalize_huffman_dict(std::array<std::vector<bool>, 256>& dict);
 std::vector<bool> next_canonical_huffman_code(const std::vector<bool>& code);
+std::array<std::vector<bool>, 256> reconstruct_canonical_dict(const std::array<uint16_t, 256>& code_lengths);
+HuffmanCodeTable huffman_code_table(const std::array<std::vector<bool>, 256>& dict);
+HuffmanCodeTable canonical_code_table(const std::array<uint16_t, 256>& code_lengths);
 
 // huffman_encdec.cpp
 
+uint64_t calculate_compressed_size_in_bits(const std::array<uint64_t, 256>& hist, const HuffmanCodeTable& table);
+void huffman_encode_span(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table);
+void huffman_encode_span_parallel(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table);
+void huffman_encode_span_parallel_twopass(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table);
+void huffman_encode_span_64bit(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table);
+
+std::vector<uint16_t> huffman_build_reverse_dict(const HuffmanCodeTable& table, const size_t table_bits);
+void huffman_decode_span(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanCodeTable& table, const size_t table_bits = MAX_CODE_LEN);
+
+// Multi-symbol decode table: every table_bits wide window of the bitstream maps to all the complete codes it starts
+// with (up to HUFFMAN_DECODE_MAX_SYMBOLS), so short codes are decoded several at a time.
+constexpr size_t HUFFMAN_DECODE_MAX_SYMBOLS = 4;
+struct alignas(8) HuffmanDecodeEntry {
+    uint8_t symbols[HUFFMAN_DECODE_MAX_SYMBOLS];
+    uint8_t num_symbols;    // complete symbols in the window
+    uint8_t num_bits;       // bits taken by those symbols
+    uint8_t first_len;      // bits taken by symbols[0] alone
+};
+struct HuffmanDecodeTable {
+    size_t table_bits;
+    std::vector<HuffmanDecodeEntry> entries;
+};
+
+HuffmanDecodeTable huffman_build_decode_table(const HuffmanCodeTable& table, const size_t table_bits = MAX_CODE_LEN);
+void huffman_decode_span_multisymbol(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table);
+void huffman_decode_span_parallel(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table, const std::span<const uint64_t> index, const uint64_t index_interval);
+
+// Multi-stream coding: the source is cut into num_streams (4 or 8) contiguous parts that share one code table but are
+// encoded into separate byte aligned bitstreams, stored back to back. The decoder advances all the streams in one
+// interleaved loop, so a single core has several independent lookup chains in flight.
+constexpr size_t HUFFMAN_DEFAULT_NUM_STREAMS = 4;
+// Sums the bytes of the streams, throws when the sizes, e.g. read from a damaged file, overflow the sum.
+uint64_t huffman_stream_bytes(const std::span<const uint64_t> stream_sizes_in_bits);
+std::vector<uint64_t> huffman_stream_sizes_in_bits(const std::span<const std::byte> source, const HuffmanCodeTable& table, const size_t num_streams = HUFFMAN_DEFAULT_NUM_STREAMS);
+void huffman_encode_span_multistream(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table, const std::span<const uint64_t> stream_sizes_in_bits);
+void huffman_decode_span_multistream(const std::span<const std::byte> source, const std::span<const uint64_t> stream_sizes_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table);
+
+// The bytes that hold a number of bits. Unlike (bits + 7) / 8 it can't wrap around for sizes read from a file.
+constexpr uint64_t bits_to_bytes(const uint64_t bits) {
+    return bits / 8 + (bits % 8 != 0);
+}
+
+// huffman_file.cpp
+
 /*
-    huffman compressed file layout:
+    huffman compressed file layout (legacy, written by huffman_encode_file):
     
     [8 bytes]   : uint64_t original file size
     [8 bytes]   : uint64_t compressed data size (in bits)
     [512 bytes] : code lengths (256 * sizeof(uint16_t))
     [n bytes]   : compressed data
+
+    All the other formats start with a HuffmanFileTag holding the format version. Read as the little endian size
+    field of a legacy header the tag is at least 2^56, so the two can't be confused.
+
+    indexed layout (HuffmanFormat::INDEXED, written by huffman_encode_file_indexed):
+
+    [8 bytes]   : HuffmanFileTag
+    [528 bytes] : HuffmanHeader
+    [16 bytes]  : HuffmanIndexHeader
+    [8k bytes]  : uint64_t bit offset of each of the k segments in the compressed data
+    [n bytes]   : compressed data, segment i decodes to original bytes [i * interval, (i + 1) * interval)
+
+    multi-stream layout (HuffmanFormat::MULTISTREAM, written by huffman_encode_file_multistream):
+
+    [8 bytes]   : HuffmanFileTag
+    [528 bytes] : HuffmanHeader, compressed data size includes the padding at the end of each stream
+    [8 bytes]   : HuffmanStreamsHeader
+    [8k bytes]  : uint64_t size in bits of each of the k streams
+    [n bytes]   : the streams, each padded to a whole byte
+
+    streaming layout (HuffmanFormat::STREAMING, written by huffman_encode_stream):
+
+    [8 bytes]   : HuffmanFileTag
+    then for every block of at most block_size original bytes:
+    [528 bytes] : HuffmanHeader of the block
+    [n bytes]   : compressed data of the block
+    [528 bytes] : HuffmanHeader with an original size of 0, marks the end of the blocks
+
+    adaptive layout (HuffmanFormat::ADAPTIVE, written by huffman_encode_file_adaptive):
+
+    [8 bytes]   : HuffmanFileTag
+    [24 bytes]  : HuffmanAdaptiveHeader
+    [8k bytes]  : uint64_t offset of each of the k block records from the end of this list
+    then for every block of block_size original bytes (the last one may be shorter):
+    [16 bytes]  : HuffmanBlockHeader
+    [512 bytes] : code lengths of the block, left out when the block reuses the previous table
+    [n bytes]   : compressed data of the block, padded to a whole byte
+
+    stored layout (HuffmanFormat::STORED, written by huffman_encode_file when coding would not save space):
+
+    [8 bytes]   : HuffmanFileTag
+    [8 bytes]   : uint64_t original file size
+    [n bytes]   : the original data
+
+    compact layout (HuffmanFormat::COMPACT, written by huffman_encode_file_compact), everything after the original
+    size is left out for an empty file:
+
+    [8 bytes]   : HuffmanFileTag
+    [1-10 bytes]: LEB128 varint original file size
+    [1 byte]    : first symbol with a code
+    [1 byte]    : last symbol with a code
+    [k bytes]   : code lengths of the symbols from first to last, two 4-bit lengths per byte, high nibble first
+    [n bytes]   : compressed data, its size in bits is only known up to the padding of the last byte
 */
 struct HuffmanHeader {
     uint64_t original_file_size;
@@ -44,14 +158,69 @@ struct HuffmanHeader {
 };
 constexpr size_t HUFFMAN_HEADER_SIZE = sizeof(HuffmanHeader);
 
-uint64_t calculate_compressed_size_in_bits(const std::array<uint64_t, 256>& hist, const std::array<std::vector<bool>, 256>& dict);
-void huffman_encode_span(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict);
-void huffman_encode_span_parallel(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict);
-void huffman_encode_span_parallel_twopass(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict);
+enum class HuffmanFormat : uint8_t {
+    LEGACY = 1, // no tag
+    INDEXED = 2,
+    MULTISTREAM = 3,
+    STREAMING = 4,
+    ADAPTIVE = 5,
+    STORED = 6,
+    COMPACT = 7,
+};
+
+constexpr std::array<char, 7> HUFFMAN_MAGIC = {'C', 'A', 'F', 'H', 'U', 'F', 'F'};
+struct HuffmanFileTag {
+    std::array<char, 7> magic;
+    uint8_t version;
+};
+
+struct HuffmanIndexHeader {
+    uint64_t interval;      // original bytes per segment
+    uint64_t num_entries;
+};
+constexpr size_t HUFFMAN_STORED_HEADER_SIZE = sizeof(HuffmanFileTag) + sizeof(uint64_t);
+
+constexpr uint64_t HUFFMAN_DEFAULT_INDEX_INTERVAL = 1 << 20;
+
+struct HuffmanStreamsHeader {
+    uint64_t num_streams;
+};
+
+// Memory used by the streaming coder is a small multiple of the block size, whatever the size of the input.
+constexpr size_t HUFFMAN_DEFAULT_BLOCK_SIZE = 1 << 22;
+constexpr size_t HUFFMAN_MAX_BLOCK_SIZE = 1 << 30;
 
-std::array<uint16_t, 512> huffman_build_reverse_dict(const std::array<std::vector<bool>, 256>& dict, const size_t max_code_len);
-void huffman_decode_span(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict);
+struct HuffmanAdaptiveHeader {
+    uint64_t original_file_size;
+    uint64_t block_size;
+    uint64_t num_blocks;
+};
 
-uint64_t huffman_encode_file(const std::string& input_file, const std::string& output_file);
+// Set when a block is coded with the code lengths of the closest earlier block that stores them.
+constexpr uint64_t HUFFMAN_BLOCK_REUSE_TABLE = 1;
+struct HuffmanBlockHeader {
+    uint64_t compressed_data_size;  // in bits
+    uint64_t flags;
+};
+constexpr size_t HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE = 1 << 18;
+
+// With store_incompressible set, data that would not get smaller is stored as is. The entropy of the histogram is a
+// lower bound on the coded size, so for data like compressed media or encrypted archives the code isn't even built.
+uint64_t huffman_encode_file(const std::string& input_file, const std::string& output_file, const size_t max_code_len = MAX_CODE_LEN, const bool store_incompressible = false);
+// huffman_encode_file for data that is already in memory and whose histogram is already known.
+uint64_t huffman_encode_span_to_file(const std::span<const std::byte> input_data, const std::array<uint64_t, 256>& hist, const std::string& output_file, const size_t max_code_len = MAX_CODE_LEN, const bool store_incompressible = false);
+uint64_t huffman_encode_file_indexed(const std::string& input_file, const std::string& output_file, const uint64_t index_interval = HUFFMAN_DEFAULT_INDEX_INTERVAL, const size_t max_code_len = MAX_CODE_LEN);
+uint64_t huffman_encode_file_multistream(const std::string& input_file, const std::string& output_file, const size_t num_streams = HUFFMAN_DEFAULT_NUM_STREAMS, const size_t max_code_len = MAX_CODE_LEN);
+// Gives every block its own code lengths when that saves more than the 512 bytes they take, and otherwise reuses the
+// previous ones. Blocks are encoded and decoded in parallel.
+uint64_t huffman_encode_file_adaptive(const std::string& input_file, const std::string& output_file, const size_t block_size = HUFFMAN_DEFAULT_ADAPTIVE_BLOCK_SIZE, const size_t max_code_len = MAX_CODE_LEN);
+// Same coding as huffman_encode_file with a header of a few dozen bytes instead of HUFFMAN_HEADER_SIZE, for small files.
+uint64_t huffman_encode_file_compact(const std::string& input_file, const std::string& output_file, const size_t max_code_len = MAX_CODE_LEN, const bool store_incompressible = false);
+uint64_t huffman_encode_span_to_file_compact(const std::span<const std::byte> input_data, const std::array<uint64_t, 256>& hist, const std::string& output_file, const size_t max_code_len = MAX_CODE_LEN, const bool store_incompressible = false);
 uint64_t huffman_decode_file(const std::string& input_file, const std::string& output_file);
+
+// Streaming coder on plain file descriptors, so pipes, sockets and stdin work as well as files. Only ever holds one
+// block in memory. huffman_decode_file also reads the streaming format.
+uint64_t huffman_encode_stream(const int input_fd, const int output_fd, const size_t block_size = HUFFMAN_DEFAULT_BLOCK_SIZE, const size_t max_code_len = MAX_CODE_LEN);
+uint64_t huffman_decode_stream(const int input_fd, const int output_fd);
 #endif // HUFFMAN_H
\ No newline at end of file
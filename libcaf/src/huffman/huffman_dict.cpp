@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
 
 // builds a dictionary based on the huffman tree nodes
 std::array<std::vector<bool>, 256> huffman_dict(const std::vector<HuffmanNode>& nodes) {
@@ -109,4 +110,102 @@ std::vector<bool> next_canonical_huffman_code(const std::vector<bool>& code) {
     // Deal with overflow
     new_code.insert(new_code.begin(), true);
     return new_code;
-}
\ No newline at end of file
+}
+
+std::array<std::vector<bool>, 256> reconstruct_canonical_dict(const std::array<uint16_t, 256>& code_lengths) {
+    std::array<std::vector<bool>, 256> dict;
+    
+    struct Entry { uint16_t len; uint16_t sym; };
+    std::vector<Entry> entries;
+    entries.reserve(256);
+    
+    for (size_t sym = 0; sym < 256; ++sym) {
+        if (code_lengths[sym] > 0) {
+            entries.emplace_back(code_lengths[sym], static_cast<uint16_t>(sym));
+        }
+    }
+    
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.len != b.len) return a.len < b.len;
+        return a.sym < b.sym;
+    });
+    
+    uint64_t current_code = 0;
+    uint16_t current_len = 0;
+    
+    for (const auto& entry : entries) {
+        while (current_len < entry.len) {
+            current_code <<= 1;
+            current_len++;
+        }
+        
+        std::vector<bool> code_vec;
+        code_vec.reserve(current_len);
+        for (int i = current_len - 1; i >= 0; --i) {
+            code_vec.emplace_back((current_code >> i) & 1);
+        }
+        
+        dict[entry.sym] = code_vec;
+        
+        current_code++;
+    }
+    
+    return dict;
+}
+
+HuffmanCodeTable huffman_code_table(const std::array<std::vector<bool>, 256>& dict) {
+    HuffmanCodeTable table{};
+
+    for (size_t symbol = 0; symbol < 256; symbol++) {
+        const std::vector<bool>& code = dict[symbol];
+        if (code.size() > sizeof(HuffmanCode::code) * 8)
+            throw std::invalid_argument("Huffman code is too long for a packed code table");
+
+        uint32_t packed = 0;
+        for (const bool bit : code) {
+            packed = (packed << 1) | bit;
+        }
+
+        table[symbol] = {packed, static_cast<uint8_t>(code.size())};
+    }
+
+    return table;
+}
+
+// same assignment as reconstruct_canonical_dict, without going through std::vector<bool>
+HuffmanCodeTable canonical_code_table(const std::array<uint16_t, 256>& code_lengths) {
+    HuffmanCodeTable table{};
+
+    std::array<uint16_t, 256> symbols;
+    size_t num_symbols = 0;
+    for (size_t sym = 0; sym < 256; ++sym) {
+        if (code_lengths[sym] > sizeof(HuffmanCode::code) * 8)
+            throw std::invalid_argument("Huffman code is too long for a packed code table");
+        if (code_lengths[sym] > 0)
+            symbols[num_symbols++] = static_cast<uint16_t>(sym);
+    }
+
+    // sort by length, then by symbol value; symbols are already in order so a stable sort is enough
+    std::stable_sort(symbols.begin(), symbols.begin() + num_symbols, [&](uint16_t a, uint16_t b) {
+        return code_lengths[a] < code_lengths[b];
+    });
+
+    uint64_t current_code = 0;
+    uint16_t current_len = 0;
+
+    for (size_t i = 0; i < num_symbols; ++i) {
+        const uint16_t sym = symbols[i];
+        current_code <<= code_lengths[sym] - current_len;
+        current_len = code_lengths[sym];
+
+        // lengths whose Kraft sum exceeds 1 run out of codes, decode tables built from them would overflow
+        if (current_code >> current_len != 0)
+            throw std::invalid_argument("Huffman code lengths are over-subscribed");
+
+        table[sym] = {static_cast<uint32_t>(current_code), static_cast<uint8_t>(current_len)};
+
+        current_code++;
+    }
+
+    return table;
+}
@@ -2,43 +2,38 @@
 
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
 #include <algorithm>
 #include <omp.h>
 #include <cstring>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <algorithm>
+#include <bit>
 
 #include "../util/bitreader.h"
 
-uint64_t calculate_compressed_size_in_bits(const std::array<uint64_t, 256>& hist, const std::array<std::vector<bool>, 256>& dict) {
+uint64_t calculate_compressed_size_in_bits(const std::array<uint64_t, 256>& hist, const HuffmanCodeTable& table) {
     uint64_t total_bits = 0;
 
     // add bits required for the compressed data
     for (size_t i = 0; i < hist.size(); ++i) {
-        total_bits += hist[i] * dict[i].size();
+        total_bits += hist[i] * table[i].len;
     }
 
     return total_bits;
 }
 
-void huffman_encode_span(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict) {
+void huffman_encode_span(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table) {
     uint64_t bitstream_position = 0;
 
     for (size_t i = 0; i < source.size(); ++i) {
         uint8_t byte = static_cast<uint8_t>(source[i]);
-        const std::vector<bool>& code = dict[byte];
+        const HuffmanCode code = table[byte];
 
-        for (size_t j = 0; j < code.size(); ++j) {
+        for (size_t j = 0; j < code.len; ++j) {
             size_t bit_idx_in_current_byte = bitstream_position;
             size_t byte_idx = bit_idx_in_current_byte / 8;
             size_t bit_offset = 7 - (bit_idx_in_current_byte % 8); // Store bits from MSB to LSB
 
-            // assume span is zeroed, so only set bits when code[j] is true
-            std::byte code_bit = code[j] ? std::byte{1} : std::byte{0};
+            // assume span is zeroed, so only set bits when the j-th bit of the code is set
+            std::byte code_bit = static_cast<std::byte>((code.code >> (code.len - 1 - j)) & 1);
             destination[byte_idx] |= static_cast<std::byte>(code_bit << bit_offset);
 
             bitstream_position++;
@@ -46,27 +41,112 @@ void huffman_encode_span(const std::span<const std::byte> source, const std::spa
     }
 }
 
-std::array<uint16_t, 512> huffman_build_reverse_dict(const std::array<std::vector<bool>, 256>& dict, const size_t max_code_len) {
-    std::array<uint16_t, 512> reverse_dict = {};
+// writes the 8 bytes of value in big-endian order, so the most significant bit of the accumulator is emitted first
+static inline void store_be64(std::byte* destination, uint64_t value) {
+    if constexpr (std::endian::native == std::endian::little)
+        value = __builtin_bswap64(value);
+    std::memcpy(destination, &value, sizeof(value));
+}
+
+// reads 8 bytes in big-endian order, the first bit of the bitstream ends up in the most significant bit
+static inline uint64_t load_be64(const std::byte* source) {
+    uint64_t value;
+    std::memcpy(&value, source, sizeof(value));
+    if constexpr (std::endian::native == std::endian::little)
+        value = __builtin_bswap64(value);
+    return value;
+}
+
+// Appends SYMBOLS_PER_FLUSH codes to the right-aligned accumulator, then stores its pending bits as one 8-byte word
+// and advances the output by the number of complete bytes. The partial last byte is rewritten by the next store,
+// so at most 7 bits stay pending and SYMBOLS_PER_FLUSH codes must fit in the remaining 56 bits.
+// Stops when fewer than SYMBOLS_PER_FLUSH symbols or 8 output bytes are left, returns the number of symbols encoded.
+template <size_t SYMBOLS_PER_FLUSH>
+static size_t encode_span_64bit_words(const std::span<const std::byte> source, std::byte*& out, std::byte* const out_end,
+                                      uint64_t& accumulator, size_t& pending_bits, const HuffmanCodeTable& table) {
+    size_t i = 0;
+
+    while (i + SYMBOLS_PER_FLUSH <= source.size() && out + 8 <= out_end) {
+        for (size_t k = 0; k < SYMBOLS_PER_FLUSH; ++k) {
+            const HuffmanCode code = table[static_cast<uint8_t>(source[i + k])];
+            accumulator = (accumulator << code.len) | code.code;
+            pending_bits += code.len;
+        }
+        i += SYMBOLS_PER_FLUSH;
+
+        // pending_bits <= 63, split the shift so that it is well defined even when nothing is pending
+        store_be64(out, (accumulator << (63 - pending_bits)) << 1);
+        out += pending_bits / 8;
+        pending_bits %= 8;
+    }
+
+    return i;
+}
+
+// Same bitstream as huffman_encode_span, but codes are collected in a 64-bit register and written out a whole word at
+// a time, instead of OR-ing every bit into place. The destination does not need to be zeroed.
+void huffman_encode_span_64bit(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table) {
+    std::byte* out = destination.data();
+    std::byte* const out_end = out + destination.size();
+    uint64_t accumulator = 0;
+    size_t pending_bits = 0;
+
+    size_t max_len = 0;
+    for (const HuffmanCode& code : table) {
+        max_len = std::max<size_t>(max_len, code.len);
+    }
+
+    // encode as many symbols per store as fit in the 56 free bits of the accumulator
+    size_t i;
+    if (max_len <= 14)
+        i = encode_span_64bit_words<4>(source, out, out_end, accumulator, pending_bits, table);
+    else if (max_len <= 18)
+        i = encode_span_64bit_words<3>(source, out, out_end, accumulator, pending_bits, table);
+    else if (max_len <= 28)
+        i = encode_span_64bit_words<2>(source, out, out_end, accumulator, pending_bits, table);
+    else
+        i = encode_span_64bit_words<1>(source, out, out_end, accumulator, pending_bits, table);
+
+    // the last few symbols don't have room for a full 8-byte store, write them a byte at a time
+    for (; i < source.size(); ++i) {
+        const HuffmanCode code = table[static_cast<uint8_t>(source[i])];
+        accumulator = (accumulator << code.len) | code.code;
+        pending_bits += code.len;
+
+        while (pending_bits >= 8) {
+            pending_bits -= 8;
+            *out++ = static_cast<std::byte>(accumulator >> pending_bits);
+        }
+    }
+
+    if (pending_bits > 0)
+        *out = static_cast<std::byte>(accumulator << (8 - pending_bits));
+}
+
+std::vector<uint16_t> huffman_build_reverse_dict(const HuffmanCodeTable& table, const size_t table_bits) {
+    if (table_bits > MAX_CODE_LEN)
+        throw std::invalid_argument("Decode table width exceeds MAX_CODE_LEN");
+
+    std::vector<uint16_t> reverse_dict(size_t{1} << table_bits, 0);
 
     for (size_t symbol = 0; symbol < 256; symbol++) {
-        const std::vector<bool>& code = dict[symbol];
-        size_t len = code.size();
+        size_t len = table[symbol].len;
         if(len == 0)
             continue;
 
-        uint16_t symbol_code = 0;
-        for (size_t i = 0; i < len; ++i) {
-            symbol_code = (symbol_code << 1) | code[i];
-        }
-        symbol_code <<= max_code_len - len;
+        if (len > table_bits)
+            throw std::invalid_argument("Huffman code is longer than the decode table width");
+
+        const size_t symbol_code = static_cast<size_t>(table[symbol].code) << (table_bits - len);
 
         // For a bit string of length len, the prefix uniquely defines the symbol
         // so we can have multiple entries that all point to the same symbol
         // without conflicts
         // e.g. if 'A' has huffman code 00 then
         // [0000] => 'A', [0001] => 'A', [0010] => 'A', [0011] => 'A'
-        uint64_t num_entries = (1 << (max_code_len - len));
+        const size_t num_entries = size_t{1} << (table_bits - len);
+        if (symbol_code + num_entries > reverse_dict.size())
+            throw std::invalid_argument("Huffman code does not fit in its length");
 
         for (size_t i = 0; i < num_entries; ++i) {
             reverse_dict[symbol_code + i] = symbol;
@@ -76,16 +156,18 @@ std::array<uint16_t, 512> huffman_build_reverse_dict(const std::array<std::vecto
     return reverse_dict;
 }
 
-void huffman_decode_span(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict) {
-    std::array<uint16_t, 512> reverse_dict = huffman_build_reverse_dict(dict, MAX_CODE_LEN);
+void huffman_decode_span(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanCodeTable& table, const size_t table_bits) {
+    std::vector<uint16_t> reverse_dict = huffman_build_reverse_dict(table, table_bits);
 
     BitReader reader(source, source_size_in_bits);
     
     size_t dst_byte_idx = 0;
     while (!reader.done()) {
-        uint64_t code = reader.read(MAX_CODE_LEN);
+        // near the end of the stream there may be fewer than table_bits bits left, pad them with zeros
+        const size_t peek_bits = std::min(table_bits, reader.remaining());
+        uint64_t code = reader.read(peek_bits) << (table_bits - peek_bits);
         uint8_t symbol = reverse_dict[code];
-        size_t symbol_len = dict[symbol].size();
+        size_t symbol_len = table[symbol].len;
         
         destination[dst_byte_idx++] = static_cast<std::byte>(symbol);
         reader.advance(symbol_len);
@@ -93,7 +175,266 @@ void huffman_decode_span(const std::span<const std::byte> source, const size_t s
 }
 
 
-void huffman_encode_span_parallel(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict) {
+HuffmanDecodeTable huffman_build_decode_table(const HuffmanCodeTable& table, const size_t table_bits) {
+    // single symbol lookup first, a code length of 0 marks a window that starts with no valid code
+    const std::vector<uint16_t> reverse_dict = huffman_build_reverse_dict(table, table_bits);
+    const size_t table_size = reverse_dict.size();
+    const size_t mask = table_size - 1;
+
+    HuffmanDecodeTable decode_table;
+    decode_table.table_bits = table_bits;
+    decode_table.entries.resize(table_size);
+
+    for (size_t window = 0; window < table_size; ++window) {
+        HuffmanDecodeEntry& entry = decode_table.entries[window];
+        size_t consumed = 0;
+
+        // keep taking codes while the next one lies completely inside the window
+        while (entry.num_symbols < HUFFMAN_DECODE_MAX_SYMBOLS) {
+            const size_t remaining_bits = table_bits - consumed;
+            const size_t index = (window << consumed) & mask; // remaining bits, zero padded
+            const uint8_t symbol = static_cast<uint8_t>(reverse_dict[index]);
+            const size_t len = table[symbol].len;
+
+            // reverse_dict maps windows with no valid code to symbol 0, check that its code actually matches
+            const bool matches = len > 0 && (index >> (table_bits - len)) == table[symbol].code;
+            if (!matches || len > remaining_bits)
+                break;
+
+            entry.symbols[entry.num_symbols++] = symbol;
+            consumed += len;
+            if (entry.num_symbols == 1)
+                entry.first_len = static_cast<uint8_t>(len);
+        }
+
+        if (entry.num_symbols == 0) {
+            // only reachable with corrupt data or an incomplete code, consume the window so decoding terminates
+            entry.num_symbols = 1;
+            entry.first_len = static_cast<uint8_t>(table_bits);
+            consumed = table_bits;
+        }
+
+        entry.num_bits = static_cast<uint8_t>(consumed);
+    }
+
+    return decode_table;
+}
+
+// Decodes destination.size() symbols starting at bit_pos. Each lookup peeks table_bits bits and emits every complete
+// symbol the window contains. One 64-bit refill holds at least 57 valid bits, enough for 4 lookups, and the fast loop
+// always copies 4 symbol bytes so it stops HUFFMAN_DECODE_MAX_SYMBOLS * 4 bytes before the end of the destination.
+// The tail decodes one symbol per lookup from a zero padded window so it never reads or writes out of bounds.
+// Returns the bit position after the last decoded symbol.
+static uint64_t decode_multisymbol(const std::span<const std::byte> source, uint64_t bit_pos,
+                                   const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table) {
+    static_assert(4 * MAX_CODE_LEN <= 57, "4 lookups must fit in one refill");
+
+    const HuffmanDecodeEntry* entries = decode_table.entries.data();
+    const size_t shift = 64 - decode_table.table_bits;
+    const std::byte* src = source.data();
+    std::byte* dst = destination.data();
+    size_t out = 0;
+
+    while (out + 4 * HUFFMAN_DECODE_MAX_SYMBOLS <= destination.size() && (bit_pos >> 3) + 8 <= source.size()) {
+        uint64_t window = load_be64(src + (bit_pos >> 3)) << (bit_pos & 7);
+
+        for (size_t lookup = 0; lookup < 4; ++lookup) {
+            const HuffmanDecodeEntry& entry = entries[window >> shift];
+            std::memcpy(dst + out, entry.symbols, HUFFMAN_DECODE_MAX_SYMBOLS);
+            out += entry.num_symbols;
+            window <<= entry.num_bits;
+            bit_pos += entry.num_bits;
+        }
+    }
+
+    while (out < destination.size()) {
+        uint64_t window = 0;
+        const size_t byte_pos = bit_pos >> 3;
+        for (size_t i = 0; i < 8 && byte_pos + i < source.size(); ++i) {
+            window |= static_cast<uint64_t>(src[byte_pos + i]) << (56 - 8 * i);
+        }
+        window <<= bit_pos & 7;
+
+        const HuffmanDecodeEntry& entry = entries[window >> shift];
+        dst[out++] = static_cast<std::byte>(entry.symbols[0]);
+        bit_pos += entry.first_len;
+    }
+
+    return bit_pos;
+}
+
+void huffman_decode_span_multisymbol(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table) {
+    const uint64_t end_bit = decode_multisymbol(source, 0, destination, decode_table);
+
+    if (end_bit > source_size_in_bits)
+        throw std::runtime_error("Compressed data ended before all symbols were decoded");
+}
+
+
+// Every segment of the index is decoded on its own thread, straight into its slice of the destination.
+// index[i] is the bit offset of the segment holding destination bytes [i * index_interval, (i + 1) * index_interval).
+void huffman_decode_span_parallel(const std::span<const std::byte> source, const size_t source_size_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table, const std::span<const uint64_t> index, const uint64_t index_interval) {
+    if (index_interval == 0 || index.size() != (destination.size() + index_interval - 1) / index_interval)
+        throw std::invalid_argument("Index does not cover the destination");
+
+    bool failed = false;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t segment = 0; segment < index.size(); ++segment) {
+        const size_t start = segment * index_interval;
+        const size_t length = std::min<size_t>(index_interval, destination.size() - start);
+        const uint64_t end_bit = segment + 1 < index.size() ? index[segment + 1] : source_size_in_bits;
+
+        // exceptions can't leave an OpenMP region, check the bounds here and report after the loop
+        if (index[segment] > end_bit || end_bit > source.size() * 8) {
+            #pragma omp atomic write
+            failed = true;
+            continue;
+        }
+
+        const uint64_t decoded_end = decode_multisymbol(source, index[segment], destination.subspan(start, length), decode_table);
+        if (decoded_end > end_bit) {
+            #pragma omp atomic write
+            failed = true;
+        }
+    }
+
+    if (failed)
+        throw std::runtime_error("Compressed segment does not match the index");
+}
+
+// Stream i holds source bytes [i * part, (i + 1) * part) with part = ceil(n / num_streams), so every stream but the
+// last has the same length and the decoder can keep all of them in its interleaved loop for as long as possible.
+static size_t stream_part_size(const size_t source_size, const size_t num_streams) {
+    return (source_size + num_streams - 1) / num_streams;
+}
+
+static std::span<const std::byte> stream_part(const std::span<const std::byte> source, const size_t num_streams, const size_t stream) {
+    const size_t part = stream_part_size(source.size(), num_streams);
+    const size_t start = std::min(stream * part, source.size());
+    return source.subspan(start, std::min(part, source.size() - start));
+}
+
+static void check_num_streams(const size_t num_streams) {
+    if (num_streams != 4 && num_streams != 8)
+        throw std::invalid_argument("Number of streams must be 4 or 8");
+}
+
+uint64_t huffman_stream_bytes(const std::span<const uint64_t> stream_sizes_in_bits) {
+    uint64_t total_bytes = 0;
+    for (const uint64_t bits : stream_sizes_in_bits) {
+        const uint64_t bytes = bits_to_bytes(bits);
+        if (bytes > UINT64_MAX - total_bytes)
+            throw std::runtime_error("Stream sizes overflow");
+        total_bytes += bytes;
+    }
+    return total_bytes;
+}
+
+std::vector<uint64_t> huffman_stream_sizes_in_bits(const std::span<const std::byte> source, const HuffmanCodeTable& table, const size_t num_streams) {
+    check_num_streams(num_streams);
+
+    std::vector<uint64_t> stream_sizes(num_streams, 0);
+    for (size_t stream = 0; stream < num_streams; ++stream) {
+        for (const std::byte b : stream_part(source, num_streams, stream)) {
+            stream_sizes[stream] += table[static_cast<uint8_t>(b)].len;
+        }
+    }
+    return stream_sizes;
+}
+
+void huffman_encode_span_multistream(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table, const std::span<const uint64_t> stream_sizes_in_bits) {
+    const size_t num_streams = stream_sizes_in_bits.size();
+    check_num_streams(num_streams);
+
+    if (destination.size() < huffman_stream_bytes(stream_sizes_in_bits))
+        throw std::invalid_argument("Destination is too small for the streams");
+
+    size_t offset = 0;
+    for (size_t stream = 0; stream < num_streams; ++stream) {
+        const size_t stream_bytes = bits_to_bytes(stream_sizes_in_bits[stream]);
+        huffman_encode_span_64bit(stream_part(source, num_streams, stream), destination.subspan(offset, stream_bytes), table);
+        offset += stream_bytes;
+    }
+}
+
+// Same lookups as decode_multisymbol, but NUM_STREAMS cursors take turns so the table loads of one stream overlap
+// with the shifts and stores of the others instead of every symbol waiting on the length of the previous one.
+// Runs until the shortest stream gets close to its end, decode_multisymbol then finishes each stream on its own.
+template <size_t NUM_STREAMS>
+static void decode_multistream(const std::span<const std::byte> source, const std::span<const uint64_t> stream_sizes_in_bits,
+                               const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table) {
+    const HuffmanDecodeEntry* entries = decode_table.entries.data();
+    const size_t shift = 64 - decode_table.table_bits;
+    const std::byte* src = source.data();
+    const size_t part = stream_part_size(destination.size(), NUM_STREAMS);
+
+    std::array<uint64_t, NUM_STREAMS> bit_pos;
+    std::array<uint64_t, NUM_STREAMS> end_bit;
+    std::array<std::byte*, NUM_STREAMS> out;
+    std::array<std::byte*, NUM_STREAMS> out_end;
+
+    uint64_t stream_start = 0;
+    for (size_t stream = 0; stream < NUM_STREAMS; ++stream) {
+        const size_t start = std::min(stream * part, destination.size());
+        bit_pos[stream] = stream_start * 8;
+        end_bit[stream] = bit_pos[stream] + stream_sizes_in_bits[stream];
+        out[stream] = destination.data() + start;
+        out_end[stream] = destination.data() + start + std::min(part, destination.size() - start);
+        stream_start += bits_to_bytes(stream_sizes_in_bits[stream]);
+    }
+
+    auto has_room = [&](const size_t stream) {
+        return out[stream] + 4 * HUFFMAN_DECODE_MAX_SYMBOLS <= out_end[stream] && (bit_pos[stream] >> 3) + 8 <= source.size();
+    };
+    auto all_have_room = [&]() {
+        bool room = true;
+        for (size_t stream = 0; stream < NUM_STREAMS; ++stream) {
+            room &= has_room(stream);
+        }
+        return room;
+    };
+
+    while (all_have_room()) {
+        std::array<uint64_t, NUM_STREAMS> window;
+        for (size_t stream = 0; stream < NUM_STREAMS; ++stream) {
+            window[stream] = load_be64(src + (bit_pos[stream] >> 3)) << (bit_pos[stream] & 7);
+        }
+
+        for (size_t lookup = 0; lookup < 4; ++lookup) {
+            for (size_t stream = 0; stream < NUM_STREAMS; ++stream) {
+                const HuffmanDecodeEntry& entry = entries[window[stream] >> shift];
+                std::memcpy(out[stream], entry.symbols, HUFFMAN_DECODE_MAX_SYMBOLS);
+                out[stream] += entry.num_symbols;
+                window[stream] <<= entry.num_bits;
+                bit_pos[stream] += entry.num_bits;
+            }
+        }
+    }
+
+    bool overrun = false;
+    for (size_t stream = 0; stream < NUM_STREAMS; ++stream) {
+        const std::span<std::byte> rest(out[stream], out_end[stream]);
+        overrun |= decode_multisymbol(source, bit_pos[stream], rest, decode_table) > end_bit[stream];
+    }
+
+    if (overrun)
+        throw std::runtime_error("Compressed stream ended before all symbols were decoded");
+}
+
+void huffman_decode_span_multistream(const std::span<const std::byte> source, const std::span<const uint64_t> stream_sizes_in_bits, const std::span<std::byte> destination, const HuffmanDecodeTable& decode_table) {
+    check_num_streams(stream_sizes_in_bits.size());
+
+    if (huffman_stream_bytes(stream_sizes_in_bits) > source.size())
+        throw std::runtime_error("Stream sizes exceed the compressed data");
+
+    if (stream_sizes_in_bits.size() == 4)
+        decode_multistream<4>(source, stream_sizes_in_bits, destination, decode_table);
+    else
+        decode_multistream<8>(source, stream_sizes_in_bits, destination, decode_table);
+}
+
+void huffman_encode_span_parallel(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table) {
     const int num_threads = omp_get_max_threads();
     const size_t chunk_size = (source.size() + num_threads - 1) / num_threads;
 
@@ -110,7 +451,7 @@ void huffman_encode_span_parallel(const std::span<const std::byte> source, const
             uint64_t chunk_bits = 0;
             for (size_t i = start; i < end; ++i) {
                 uint8_t byte = static_cast<uint8_t>(source[i]);
-                chunk_bits += dict[byte].size();
+                chunk_bits += table[byte].len;
             }
             thread_code_lengths[thread_id] = chunk_bits;
 
@@ -120,14 +461,14 @@ void huffman_encode_span_parallel(const std::span<const std::byte> source, const
             uint64_t bitstream_position = 0;
             for (size_t i = start; i < end; ++i) {
                 uint8_t byte = static_cast<uint8_t>(source[i]);
-                const std::vector<bool>& code = dict[byte];
+                const HuffmanCode code = table[byte];
 
-                for (size_t j = 0; j < code.size(); ++j) {
+                for (size_t j = 0; j < code.len; ++j) {
                     size_t bit_idx_in_current_byte = bitstream_position;
                     size_t byte_idx = bit_idx_in_current_byte / 8;
                     size_t bit_offset = 7 - (bit_idx_in_current_byte % 8);
 
-                    std::byte code_bit = code[j] ? std::byte{1} : std::byte{0};
+                    std::byte code_bit = static_cast<std::byte>((code.code >> (code.len - 1 - j)) & 1);
                     thread_buffers[thread_id][byte_idx] |= static_cast<std::byte>(code_bit << bit_offset);
 
                     bitstream_position++;
@@ -209,7 +550,7 @@ void huffman_encode_span_parallel(const std::span<const std::byte> source, const
 }
 
 // In order to avoid joining/copying at the end, we calculate the code lengths one pass and then write directly to the destination a second pass
-void huffman_encode_span_parallel_twopass(const std::span<const std::byte> source, const std::span<std::byte> destination, const std::array<std::vector<bool>, 256>& dict) {
+void huffman_encode_span_parallel_twopass(const std::span<const std::byte> source, const std::span<std::byte> destination, const HuffmanCodeTable& table) {
     const int num_threads = omp_get_max_threads();
     const size_t chunk_size = (source.size() + num_threads - 1) / num_threads;
 
@@ -226,7 +567,7 @@ void huffman_encode_span_parallel_twopass(const std::span<const std::byte> sourc
         uint64_t chunk_bits = 0;
         for (size_t i = start; i < end; ++i) {
             uint8_t byte = static_cast<uint8_t>(source[i]);
-            chunk_bits += dict[byte].size();
+            chunk_bits += table[byte].len;
         }
         thread_code_lengths[thread_id] = chunk_bits;
     }
@@ -260,14 +601,14 @@ void huffman_encode_span_parallel_twopass(const std::span<const std::byte> sourc
             
             for (size_t i = start; i < end; ++i) {
                 uint8_t byte = static_cast<uint8_t>(source[i]);
-                const std::vector<bool>& code = dict[byte];
+                const HuffmanCode code = table[byte];
 
-                for (size_t j = 0; j < code.size(); ++j) {
+                for (size_t j = 0; j < code.len; ++j) {
                     const size_t byte_idx = bitstream_position / 8;
                     const size_t bit_offset = 7 - (bitstream_position % 8);
                     
                     // Accumulate bit into current_byte
-                    current_byte |= static_cast<uint8_t>(code[j]) << bit_offset;
+                    current_byte |= static_cast<uint8_t>((code.code >> (code.len - 1 - j)) & 1) << bit_offset;
                     
                     // Check if we've completed a byte (bit_offset == 0 means we just wrote the LSB)
                     if (bit_offset == 0) { // 
@@ -300,181 +641,3 @@ void huffman_encode_span_parallel_twopass(const std::span<const std::byte> sourc
         }
     }
 }
-
-uint64_t huffman_encode_file(const std::string& input_file, const std::string& output_file) {
-    // read input file
-    int in_fd = open(input_file.c_str(), O_RDONLY);
-    if (in_fd < 0)
-        throw std::runtime_error("Failed to open input file");
-
-    struct stat file_stat;
-    if (fstat(in_fd, &file_stat) < 0) {
-        close(in_fd);
-        throw std::runtime_error("Failed to get file size");
-    }
-
-    size_t file_size = file_stat.st_size;
-    void *in_ptr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
-    close(in_fd);
-
-    if (in_ptr == MAP_FAILED)
-        throw std::runtime_error("Failed to map file");
-
-    std::span<const std::byte> input_data(static_cast<const std::byte*>(in_ptr), file_size);
-    const std::array<uint64_t, 256> hist = histogram_parallel(input_data);
-    const std::vector<HuffmanNode> tree = huffman_tree(hist);
-    std::array<std::vector<bool>, 256> dict = huffman_dict(tree);
-    canonicalize_huffman_dict(dict);
-
-    const uint64_t compressed_size_in_bits = calculate_compressed_size_in_bits(hist, dict);
-    const uint64_t compressed_size_in_bytes = (compressed_size_in_bits + 7) / 8; // round up to full bytes
-
-    HuffmanHeader header;
-    header.original_file_size = file_size;
-    header.compressed_data_size = compressed_size_in_bits;
-    for (size_t i = 0; i < 256; i++) {
-        header.code_lengths[i] = dict[i].size();
-    }
-
-    size_t total_output_size = sizeof(HuffmanHeader) + compressed_size_in_bytes;
-    
-    int out_fd = open(output_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
-    if (out_fd < 0) {
-        munmap(in_ptr, file_size);
-        throw std::runtime_error("Failed to open output file");
-    }
-
-    if (ftruncate(out_fd, total_output_size) < 0) {
-        close(out_fd);
-        munmap(in_ptr, file_size);
-        throw std::runtime_error("Failed to truncate output file");
-    }
-
-    void *out_ptr = mmap(nullptr, total_output_size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
-    close(out_fd);
-
-    if (out_ptr == MAP_FAILED) {
-        munmap(in_ptr, file_size);
-        throw std::runtime_error("Failed to map file");
-    }
-
-    std::memcpy(out_ptr, &header, sizeof(HuffmanHeader));
-
-    std::byte *data_start = static_cast<std::byte*>(out_ptr) + sizeof(HuffmanHeader);
-    std::span<std::byte> output_data(data_start, compressed_size_in_bytes);
-    
-    // The actual encoding is done here
-    huffman_encode_span(input_data, output_data, dict);
-
-    // Cleanup
-    munmap(in_ptr, file_size);
-    munmap(out_ptr, total_output_size);
-
-    return total_output_size;
-}
-
-std::array<std::vector<bool>, 256> reconstruct_canonical_dict(const std::array<uint16_t, 256>& code_lengths) {
-    std::array<std::vector<bool>, 256> dict;
-    
-    struct Entry { uint16_t len; uint16_t sym; };
-    std::vector<Entry> entries;
-    entries.reserve(256);
-    
-    for (size_t sym = 0; sym < 256; ++sym) {
-        if (code_lengths[sym] > 0) {
-            entries.emplace_back(code_lengths[sym], static_cast<uint16_t>(sym));
-        }
-    }
-    
-    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
-        if (a.len != b.len) return a.len < b.len;
-        return a.sym < b.sym;
-    });
-    
-    uint64_t current_code = 0;
-    uint16_t current_len = 0;
-    
-    for (const auto& entry : entries) {
-        while (current_len < entry.len) {
-            current_code <<= 1;
-            current_len++;
-        }
-        
-        std::vector<bool> code_vec;
-        code_vec.reserve(current_len);
-        for (int i = current_len - 1; i >= 0; --i) {
-            code_vec.emplace_back((current_code >> i) & 1);
-        }
-        
-        dict[entry.sym] = code_vec;
-        
-        current_code++;
-    }
-    
-    return dict;
-}
-
-uint64_t huffman_decode_file(const std::string& input_file, const std::string& output_file) {
-    int in_fd = open(input_file.c_str(), O_RDONLY);
-    if (in_fd < 0) 
-        throw std::runtime_error("Failed to open input file");
-
-    struct stat in_stat;
-    if (fstat(in_fd, &in_stat) < 0) {
-        close(in_fd);
-        throw std::runtime_error("Failed to get input file size");
-    }
-    size_t in_size = in_stat.st_size;
-
-    if (in_size < sizeof(HuffmanHeader)) {
-        close(in_fd);
-        throw std::runtime_error("Input file too small to contain header");
-    }
-
-    void* in_ptr = mmap(nullptr, in_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
-    close(in_fd);
-
-    if (in_ptr == MAP_FAILED)
-        throw std::runtime_error("Failed to map input file");
-
-    const HuffmanHeader* header = static_cast<const HuffmanHeader*>(in_ptr);
-    size_t original_file_size = header->original_file_size;
-    size_t compressed_data_bits = header->compressed_data_size;
-
-    std::array<std::vector<bool>, 256> dict = reconstruct_canonical_dict(header->code_lengths);
-
-    int out_fd = open(output_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
-    if (out_fd < 0) {
-        munmap(in_ptr, in_size);
-        throw std::runtime_error("Failed to open output file");
-    }
-
-    if (ftruncate(out_fd, original_file_size) < 0) {
-        close(out_fd);
-        munmap(in_ptr, in_size);
-        throw std::runtime_error("Failed to resize output file");
-    }
-
-    void* out_ptr = mmap(nullptr, original_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);
-    close(out_fd);
-
-    if (out_ptr == MAP_FAILED) {
-        munmap(in_ptr, in_size);
-        throw std::runtime_error("Failed to map output file");
-    }
-
-    const std::byte* compressed_start = static_cast<const std::byte*>(in_ptr) + sizeof(HuffmanHeader);
-    size_t compressed_bytes = (compressed_data_bits + 7) / 8;
-
-    std::span<const std::byte> source_span(compressed_start, compressed_bytes);
-    std::span<std::byte> dest_span(static_cast<std::byte*>(out_ptr), original_file_size);
-
-    // The actual decoding is done here
-    huffman_decode_span(source_span, compressed_data_bits, dest_span, dict);
-
-    // Cleanup
-    munmap(out_ptr, original_file_size);
-    munmap(in_ptr, in_size);
-
-    return original_file_size;
-}
\ No newline at end of file
@@ -0,0 +1,697 @@
+#include "huffman.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../util/mapped_file.h"
+#include "../util/fd_io.h"
+#include "../util/parallel.h"
+
+// histogram -> length-limited canonical code, shared by all the file encoders
+static HuffmanHeader build_header(const std::array<uint64_t, 256>& hist, const uint64_t original_file_size, const size_t max_code_len, HuffmanCodeTable& table) {
+    HuffmanHeader header;
+    header.original_file_size = original_file_size;
+    header.code_lengths = huffman_code_lengths(hist, max_code_len);
+
+    table = canonical_code_table(header.code_lengths);
+    header.compressed_data_size = calculate_compressed_size_in_bits(hist, table);
+
+    return header;
+}
+
+static HuffmanHeader build_header(const std::span<const std::byte> input_data, const size_t max_code_len, HuffmanCodeTable& table) {
+    return build_header(histogram_parallel(input_data), input_data.size(), max_code_len, table);
+}
+
+// Lengths read from a file must form a prefix code: the Kraft sum of lengths that are too short exceeds 1 and there
+// aren't enough codes of those lengths for every symbol.
+static void validate_code_lengths(const std::array<uint16_t, 256>& code_lengths) {
+    uint64_t kraft_sum = 0; // in units of 2^-MAX_CODE_LEN
+    for (const uint16_t len : code_lengths) {
+        if (len > MAX_CODE_LEN)
+            throw std::runtime_error("Code length in header exceeds MAX_CODE_LEN");
+        if (len > 0)
+            kraft_sum += uint64_t{1} << (MAX_CODE_LEN - len);
+    }
+
+    if (kraft_sum > uint64_t{1} << MAX_CODE_LEN)
+        throw std::runtime_error("Code lengths in header are over-subscribed");
+}
+
+static void validate_header(const HuffmanHeader& header, const size_t available_data_bytes) {
+    validate_code_lengths(header.code_lengths);
+
+    if (bits_to_bytes(header.compressed_data_size) > available_data_bytes)
+        throw std::runtime_error("Input file is smaller than the compressed data size in its header");
+}
+
+static HuffmanFormat detect_format(const std::span<const std::byte> data) {
+    HuffmanFileTag tag;
+    if (data.size() < sizeof(tag))
+        return HuffmanFormat::LEGACY;
+
+    std::memcpy(&tag, data.data(), sizeof(tag));
+    if (tag.magic != HUFFMAN_MAGIC)
+        return HuffmanFormat::LEGACY;
+
+    return static_cast<HuffmanFormat>(tag.version);
+}
+
+static void write_tag(const std::span<std::byte> destination, const HuffmanFormat format) {
+    const HuffmanFileTag tag{HUFFMAN_MAGIC, static_cast<uint8_t>(format)};
+    std::memcpy(destination.data(), &tag, sizeof(tag));
+}
+
+// Shannon entropy of the histogram in bits, no prefix code can get below it.
+static double entropy_in_bits(const std::array<uint64_t, 256>& hist, const uint64_t total) {
+    double bits = 0;
+    for (const uint64_t count : hist) {
+        if (count > 0)
+            bits -= static_cast<double>(count) * std::log2(static_cast<double>(count) / static_cast<double>(total));
+    }
+    return bits;
+}
+
+static uint64_t store_file(const std::span<const std::byte> input_data, const std::string& output_file) {
+    const size_t total_output_size = HUFFMAN_STORED_HEADER_SIZE + input_data.size();
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    const uint64_t original_file_size = input_data.size();
+    write_tag(output_data, HuffmanFormat::STORED);
+    std::memcpy(output_data.data() + sizeof(HuffmanFileTag), &original_file_size, sizeof(original_file_size));
+    if (!input_data.empty())
+        std::memcpy(output_data.data() + HUFFMAN_STORED_HEADER_SIZE, input_data.data(), input_data.size());
+
+    return total_output_size;
+}
+
+uint64_t huffman_encode_file(const std::string& input_file, const std::string& output_file, const size_t max_code_len, const bool store_incompressible) {
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    return huffman_encode_span_to_file(input_data, histogram_parallel(input_data), output_file, max_code_len, store_incompressible);
+}
+
+uint64_t huffman_encode_span_to_file(const std::span<const std::byte> input_data, const std::array<uint64_t, 256>& hist, const std::string& output_file, const size_t max_code_len, const bool store_incompressible) {
+    const uint64_t stored_size = HUFFMAN_STORED_HEADER_SIZE + input_data.size();
+
+    // don't bother building a code that can't beat storing the data
+    if (store_incompressible && sizeof(HuffmanHeader) + entropy_in_bits(hist, input_data.size()) / 8 >= stored_size)
+        return store_file(input_data, output_file);
+
+    HuffmanCodeTable table;
+    const HuffmanHeader header = build_header(hist, input_data.size(), max_code_len, table);
+    const uint64_t compressed_size_in_bytes = (header.compressed_data_size + 7) / 8; // round up to full bytes
+
+    const size_t total_output_size = sizeof(HuffmanHeader) + compressed_size_in_bytes;
+    if (store_incompressible && total_output_size >= stored_size)
+        return store_file(input_data, output_file);
+
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    std::memcpy(output_data.data(), &header, sizeof(HuffmanHeader));
+
+    // The actual encoding is done here
+    huffman_encode_span_64bit(input_data, output_data.subspan(sizeof(HuffmanHeader)), table);
+
+    return total_output_size;
+}
+
+static void put_varint(std::vector<std::byte>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+static uint64_t get_varint(const std::span<const std::byte> data, size_t& offset) {
+    uint64_t value = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        if (offset >= data.size())
+            throw std::runtime_error("Input file too small to contain header");
+        const uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    throw std::runtime_error("Invalid varint in header");
+}
+
+static std::vector<std::byte> compact_header(const uint64_t original_file_size, const std::array<uint16_t, 256>& code_lengths) {
+    static_assert(MAX_CODE_LEN < 16, "code lengths must fit in a nibble");
+
+    std::vector<std::byte> header(sizeof(HuffmanFileTag));
+    write_tag(header, HuffmanFormat::COMPACT);
+    put_varint(header, original_file_size);
+    if (original_file_size == 0)
+        return header;
+
+    size_t first = 0;
+    while (code_lengths[first] == 0)
+        ++first;
+    size_t last = 255;
+    while (code_lengths[last] == 0)
+        --last;
+
+    header.push_back(static_cast<std::byte>(first));
+    header.push_back(static_cast<std::byte>(last));
+    for (size_t symbol = first; symbol <= last; symbol += 2) {
+        const uint16_t low = symbol + 1 <= last ? code_lengths[symbol + 1] : 0;
+        header.push_back(static_cast<std::byte>((code_lengths[symbol] << 4) | low));
+    }
+
+    return header;
+}
+
+uint64_t huffman_encode_file_compact(const std::string& input_file, const std::string& output_file, const size_t max_code_len, const bool store_incompressible) {
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    return huffman_encode_span_to_file_compact(input_data, histogram_parallel(input_data), output_file, max_code_len, store_incompressible);
+}
+
+uint64_t huffman_encode_span_to_file_compact(const std::span<const std::byte> input_data, const std::array<uint64_t, 256>& hist, const std::string& output_file, const size_t max_code_len, const bool store_incompressible) {
+    const uint64_t stored_size = HUFFMAN_STORED_HEADER_SIZE + input_data.size();
+    if (store_incompressible && sizeof(HuffmanFileTag) + entropy_in_bits(hist, input_data.size()) / 8 >= stored_size)
+        return store_file(input_data, output_file);
+
+    HuffmanCodeTable table;
+    const HuffmanHeader header = build_header(hist, input_data.size(), max_code_len, table);
+    const std::vector<std::byte> packed_header = compact_header(header.original_file_size, header.code_lengths);
+
+    const size_t total_output_size = packed_header.size() + (header.compressed_data_size + 7) / 8;
+    if (store_incompressible && total_output_size >= stored_size)
+        return store_file(input_data, output_file);
+
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    std::memcpy(output_data.data(), packed_header.data(), packed_header.size());
+    huffman_encode_span_64bit(input_data, output_data.subspan(packed_header.size()), table);
+
+    return total_output_size;
+}
+
+static uint64_t decode_compact_file(const std::span<const std::byte> input_data, const std::string& output_file) {
+    size_t offset = sizeof(HuffmanFileTag);
+    const uint64_t original_file_size = get_varint(input_data, offset);
+
+    std::array<uint16_t, 256> code_lengths = {0};
+    if (original_file_size > 0) {
+        if (input_data.size() < offset + 2)
+            throw std::runtime_error("Input file too small to contain header");
+        const size_t first = static_cast<uint8_t>(input_data[offset++]);
+        const size_t last = static_cast<uint8_t>(input_data[offset++]);
+        if (first > last)
+            throw std::runtime_error("Invalid code length range");
+
+        const size_t packed_size = (last - first + 2) / 2;
+        if (input_data.size() - offset < packed_size)
+            throw std::runtime_error("Input file too small to contain header");
+
+        for (size_t symbol = first; symbol <= last; ++symbol) {
+            const uint8_t packed = static_cast<uint8_t>(input_data[offset + (symbol - first) / 2]);
+            code_lengths[symbol] = (symbol - first) % 2 == 0 ? packed >> 4 : packed & 0x0F;
+        }
+        offset += packed_size;
+    }
+    validate_code_lengths(code_lengths);
+
+    const std::span<const std::byte> source_span = input_data.subspan(offset);
+    const HuffmanDecodeTable decode_table = huffman_build_decode_table(canonical_code_table(code_lengths));
+
+    MappedFile output = MappedFile::create(output_file, original_file_size);
+    huffman_decode_span_multisymbol(source_span, source_span.size() * 8, output.writable_data(), decode_table);
+
+    return original_file_size;
+}
+
+// Segments are padded to a byte boundary so every thread can encode its segment straight into the output without
+// sharing a byte with its neighbours. This wastes less than a byte per segment.
+uint64_t huffman_encode_file_indexed(const std::string& input_file, const std::string& output_file, const uint64_t index_interval, const size_t max_code_len) {
+    if (index_interval == 0)
+        throw std::invalid_argument("Index interval must be positive");
+
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    HuffmanCodeTable table;
+    HuffmanHeader header = build_header(input_data, max_code_len, table);
+
+    const size_t num_segments = (input_data.size() + index_interval - 1) / index_interval;
+    std::vector<uint64_t> index(num_segments, 0);
+
+    // first pass: the size of every segment, rounded up to whole bytes
+    #pragma omp parallel for schedule(static)
+    for (size_t segment = 0; segment < num_segments; ++segment) {
+        const std::span<const std::byte> segment_data = input_data.subspan(segment * index_interval,
+            std::min<size_t>(index_interval, input_data.size() - segment * index_interval));
+
+        uint64_t segment_bits = 0;
+        for (const std::byte b : segment_data) {
+            segment_bits += table[static_cast<uint8_t>(b)].len;
+        }
+        index[segment] = (segment_bits + 7) / 8 * 8;
+    }
+
+    // turn the sizes into offsets
+    uint64_t total_bits = 0;
+    for (uint64_t& entry : index) {
+        const uint64_t segment_bits = entry;
+        entry = total_bits;
+        total_bits += segment_bits;
+    }
+    header.compressed_data_size = total_bits;
+
+    const HuffmanIndexHeader index_header{index_interval, num_segments};
+    const size_t data_offset = sizeof(HuffmanFileTag) + sizeof(HuffmanHeader) + sizeof(HuffmanIndexHeader) + num_segments * sizeof(uint64_t);
+    const size_t total_output_size = data_offset + total_bits / 8;
+
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    write_tag(output_data, HuffmanFormat::INDEXED);
+    size_t offset = sizeof(HuffmanFileTag);
+    std::memcpy(output_data.data() + offset, &header, sizeof(header));
+    offset += sizeof(header);
+    std::memcpy(output_data.data() + offset, &index_header, sizeof(index_header));
+    offset += sizeof(index_header);
+    std::memcpy(output_data.data() + offset, index.data(), num_segments * sizeof(uint64_t));
+
+    // second pass: encode the segments in parallel
+    const std::span<std::byte> compressed_data = output_data.subspan(data_offset);
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t segment = 0; segment < num_segments; ++segment) {
+        const size_t start = segment * index_interval;
+        const uint64_t end_bit = segment + 1 < num_segments ? index[segment + 1] : total_bits;
+
+        huffman_encode_span_64bit(
+            input_data.subspan(start, std::min<size_t>(index_interval, input_data.size() - start)),
+            compressed_data.subspan(index[segment] / 8, (end_bit - index[segment]) / 8),
+            table);
+    }
+
+    return total_output_size;
+}
+
+uint64_t huffman_encode_file_multistream(const std::string& input_file, const std::string& output_file, const size_t num_streams, const size_t max_code_len) {
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    HuffmanCodeTable table;
+    HuffmanHeader header = build_header(input_data, max_code_len, table);
+
+    const std::vector<uint64_t> stream_sizes = huffman_stream_sizes_in_bits(input_data, table, num_streams);
+    const uint64_t compressed_size_in_bytes = huffman_stream_bytes(stream_sizes);
+    header.compressed_data_size = compressed_size_in_bytes * 8;
+
+    const HuffmanStreamsHeader streams_header{num_streams};
+    const size_t data_offset = sizeof(HuffmanFileTag) + sizeof(HuffmanHeader) + sizeof(HuffmanStreamsHeader) + num_streams * sizeof(uint64_t);
+    const size_t total_output_size = data_offset + compressed_size_in_bytes;
+
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    write_tag(output_data, HuffmanFormat::MULTISTREAM);
+    size_t offset = sizeof(HuffmanFileTag);
+    std::memcpy(output_data.data() + offset, &header, sizeof(header));
+    offset += sizeof(header);
+    std::memcpy(output_data.data() + offset, &streams_header, sizeof(streams_header));
+    offset += sizeof(streams_header);
+    std::memcpy(output_data.data() + offset, stream_sizes.data(), num_streams * sizeof(uint64_t));
+
+    huffman_encode_span_multistream(input_data, output_data.subspan(data_offset), table, stream_sizes);
+
+    return total_output_size;
+}
+
+// Bits taken by a block coded with the given lengths, or UINT64_MAX when one of its symbols has no code.
+static uint64_t block_cost_in_bits(const std::array<uint64_t, 256>& hist, const std::array<uint16_t, 256>& code_lengths) {
+    uint64_t bits = 0;
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        if (hist[symbol] == 0)
+            continue;
+        if (code_lengths[symbol] == 0)
+            return UINT64_MAX;
+        bits += hist[symbol] * code_lengths[symbol];
+    }
+    return bits;
+}
+
+uint64_t huffman_encode_file_adaptive(const std::string& input_file, const std::string& output_file, const size_t block_size, const size_t max_code_len) {
+    if (block_size == 0 || block_size > HUFFMAN_MAX_BLOCK_SIZE)
+        throw std::invalid_argument("Block size must be between 1 and HUFFMAN_MAX_BLOCK_SIZE");
+
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    const size_t num_blocks = (input_data.size() + block_size - 1) / block_size;
+    auto block_data = [&](const size_t block) {
+        return input_data.subspan(block * block_size, std::min(block_size, input_data.size() - block * block_size));
+    };
+
+    // every block's own optimal lengths, in parallel. Whether max_code_len fits depends on the symbols of each block,
+    // so an invalid one is only found inside the loop and rethrown after it.
+    std::vector<std::array<uint64_t, 256>> hists(num_blocks);
+    std::vector<std::array<uint16_t, 256>> own_lengths(num_blocks);
+    parallel_for_each_index(num_blocks, [&](const size_t block) {
+        hists[block] = histogram(block_data(block));
+        own_lengths[block] = huffman_code_lengths(hists[block], max_code_len);
+    });
+
+    // a block stores its own table only if that beats reusing the current one by more than the table itself
+    constexpr uint64_t table_bits = sizeof(HuffmanHeader::code_lengths) * 8;
+    std::vector<size_t> table_owner(num_blocks);
+    std::vector<uint64_t> record_sizes(num_blocks);
+    for (size_t block = 0; block < num_blocks; ++block) {
+        const uint64_t own_bits = block_cost_in_bits(hists[block], own_lengths[block]);
+        const uint64_t reuse_bits = block == 0 ? UINT64_MAX : block_cost_in_bits(hists[block], own_lengths[table_owner[block - 1]]);
+
+        const bool reuse = reuse_bits != UINT64_MAX && reuse_bits <= own_bits + table_bits;
+        table_owner[block] = reuse ? table_owner[block - 1] : block;
+
+        const uint64_t data_bits = reuse ? reuse_bits : own_bits;
+        record_sizes[block] = sizeof(HuffmanBlockHeader) + (reuse ? 0 : sizeof(HuffmanHeader::code_lengths)) + (data_bits + 7) / 8;
+    }
+
+    std::vector<uint64_t> offsets(num_blocks);
+    uint64_t blocks_size = 0;
+    for (size_t block = 0; block < num_blocks; ++block) {
+        offsets[block] = blocks_size;
+        blocks_size += record_sizes[block];
+    }
+
+    const HuffmanAdaptiveHeader header{input_data.size(), block_size, num_blocks};
+    const size_t blocks_offset = sizeof(HuffmanFileTag) + sizeof(HuffmanAdaptiveHeader) + num_blocks * sizeof(uint64_t);
+    const size_t total_output_size = blocks_offset + blocks_size;
+
+    MappedFile output = MappedFile::create(output_file, total_output_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    write_tag(output_data, HuffmanFormat::ADAPTIVE);
+    std::memcpy(output_data.data() + sizeof(HuffmanFileTag), &header, sizeof(header));
+    std::memcpy(output_data.data() + sizeof(HuffmanFileTag) + sizeof(header), offsets.data(), num_blocks * sizeof(uint64_t));
+
+    parallel_for_each_index(num_blocks, [&](const size_t block) {
+        const bool reuse = table_owner[block] != block;
+        const std::array<uint16_t, 256>& code_lengths = own_lengths[table_owner[block]];
+        const HuffmanCodeTable table = canonical_code_table(code_lengths);
+
+        std::span<std::byte> record = output_data.subspan(blocks_offset + offsets[block], record_sizes[block]);
+
+        const HuffmanBlockHeader block_header{block_cost_in_bits(hists[block], code_lengths), reuse ? HUFFMAN_BLOCK_REUSE_TABLE : 0};
+        std::memcpy(record.data(), &block_header, sizeof(block_header));
+        record = record.subspan(sizeof(block_header));
+
+        if (!reuse) {
+            std::memcpy(record.data(), code_lengths.data(), sizeof(code_lengths));
+            record = record.subspan(sizeof(code_lengths));
+        }
+
+        huffman_encode_span_64bit(block_data(block), record, table);
+    });
+
+    return total_output_size;
+}
+
+static uint64_t decode_adaptive_file(const std::span<const std::byte> input_data, const std::string& output_file) {
+    size_t offset = sizeof(HuffmanFileTag);
+
+    HuffmanAdaptiveHeader header;
+    if (input_data.size() < offset + sizeof(header))
+        throw std::runtime_error("Input file too small to contain header");
+    std::memcpy(&header, input_data.data() + offset, sizeof(header));
+    offset += sizeof(header);
+
+    if (header.block_size == 0 || header.block_size > HUFFMAN_MAX_BLOCK_SIZE ||
+        header.num_blocks != (header.original_file_size + header.block_size - 1) / header.block_size ||
+        (input_data.size() - offset) / sizeof(uint64_t) < header.num_blocks)
+        throw std::runtime_error("Invalid block index");
+
+    std::vector<uint64_t> offsets(header.num_blocks);
+    std::memcpy(offsets.data(), input_data.data() + offset, offsets.size() * sizeof(uint64_t));
+    offset += offsets.size() * sizeof(uint64_t);
+    const std::span<const std::byte> blocks = input_data.subspan(offset);
+
+    // walk the block headers once to find the data and the table of every block
+    struct BlockInfo {
+        std::span<const std::byte> data;
+        uint64_t size_in_bits;
+        size_t table;
+    };
+    std::vector<BlockInfo> infos(header.num_blocks);
+    std::vector<HuffmanDecodeTable> tables;
+
+    for (size_t block = 0; block < header.num_blocks; ++block) {
+        HuffmanBlockHeader block_header;
+        if (offsets[block] > blocks.size() || blocks.size() - offsets[block] < sizeof(block_header))
+            throw std::runtime_error("Invalid block index");
+        std::span<const std::byte> record = blocks.subspan(offsets[block]);
+        std::memcpy(&block_header, record.data(), sizeof(block_header));
+        record = record.subspan(sizeof(block_header));
+
+        if (block_header.flags & HUFFMAN_BLOCK_REUSE_TABLE) {
+            if (tables.empty())
+                throw std::runtime_error("First block has no code table");
+        } else {
+            HuffmanHeader table_header{};
+            if (record.size() < sizeof(table_header.code_lengths))
+                throw std::runtime_error("Input file too small to contain the block's code table");
+            std::memcpy(table_header.code_lengths.data(), record.data(), sizeof(table_header.code_lengths));
+            record = record.subspan(sizeof(table_header.code_lengths));
+
+            table_header.compressed_data_size = block_header.compressed_data_size;
+            validate_header(table_header, record.size());
+            tables.push_back(huffman_build_decode_table(canonical_code_table(table_header.code_lengths)));
+        }
+
+        if (bits_to_bytes(block_header.compressed_data_size) > record.size())
+            throw std::runtime_error("Input file is smaller than the compressed data size in its header");
+
+        infos[block] = {record.first(bits_to_bytes(block_header.compressed_data_size)), block_header.compressed_data_size, tables.size() - 1};
+    }
+
+    MappedFile output = MappedFile::create(output_file, header.original_file_size);
+    const std::span<std::byte> output_data = output.writable_data();
+
+    bool failed = false;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t block = 0; block < header.num_blocks; ++block) {
+        const size_t start = block * header.block_size;
+        const std::span<std::byte> destination = output_data.subspan(start, std::min<size_t>(header.block_size, output_data.size() - start));
+
+        // exceptions can't leave an OpenMP region, report after the loop
+        try {
+            huffman_decode_span_multisymbol(infos[block].data, infos[block].size_in_bits, destination, tables[infos[block].table]);
+        } catch (const std::exception& e) {
+            #pragma omp atomic write
+            failed = true;
+        }
+    }
+
+    if (failed)
+        throw std::runtime_error("Compressed block ended before all symbols were decoded");
+
+    return header.original_file_size;
+}
+
+uint64_t huffman_encode_stream(const int input_fd, const int output_fd, const size_t block_size, const size_t max_code_len) {
+    if (block_size == 0 || block_size > HUFFMAN_MAX_BLOCK_SIZE)
+        throw std::invalid_argument("Block size must be between 1 and HUFFMAN_MAX_BLOCK_SIZE");
+
+    std::vector<std::byte> block(block_size);
+    std::vector<std::byte> compressed;
+
+    std::array<std::byte, sizeof(HuffmanFileTag)> tag;
+    write_tag(tag, HuffmanFormat::STREAMING);
+    write_full(output_fd, tag);
+    uint64_t total_output_size = sizeof(HuffmanFileTag);
+
+    while (true) {
+        const std::span<const std::byte> block_data(block.data(), read_full(input_fd, block));
+        if (block_data.empty())
+            break;
+
+        HuffmanCodeTable table;
+        const HuffmanHeader header = build_header(block_data, max_code_len, table);
+        const size_t compressed_size_in_bytes = (header.compressed_data_size + 7) / 8;
+
+        compressed.assign(compressed_size_in_bytes, std::byte{0});
+        huffman_encode_span_64bit(block_data, compressed, table);
+
+        write_full(output_fd, std::as_bytes(std::span(&header, 1)));
+        write_full(output_fd, compressed);
+        total_output_size += sizeof(HuffmanHeader) + compressed_size_in_bytes;
+
+        if (block_data.size() < block_size)
+            break;
+    }
+
+    const HuffmanHeader end_marker{};
+    write_full(output_fd, std::as_bytes(std::span(&end_marker, 1)));
+
+    return total_output_size + sizeof(HuffmanHeader);
+}
+
+uint64_t huffman_decode_stream(const int input_fd, const int output_fd) {
+    HuffmanFileTag tag;
+    if (read_full(input_fd, std::as_writable_bytes(std::span(&tag, 1))) != sizeof(tag) ||
+        tag.magic != HUFFMAN_MAGIC || tag.version != static_cast<uint8_t>(HuffmanFormat::STREAMING))
+        throw std::runtime_error("Input is not a streaming huffman file");
+
+    std::vector<std::byte> compressed;
+    std::vector<std::byte> block;
+    uint64_t total_output_size = 0;
+
+    while (true) {
+        HuffmanHeader header;
+        if (read_full(input_fd, std::as_writable_bytes(std::span(&header, 1))) != sizeof(header))
+            throw std::runtime_error("Input ended before the last block");
+
+        if (header.original_file_size == 0)
+            break;
+
+        if (header.original_file_size > HUFFMAN_MAX_BLOCK_SIZE || header.compressed_data_size > header.original_file_size * MAX_CODE_LEN)
+            throw std::runtime_error("Invalid block header");
+
+        compressed.resize(bits_to_bytes(header.compressed_data_size));
+        if (read_full(input_fd, compressed) != compressed.size())
+            throw std::runtime_error("Input ended in the middle of a block");
+        validate_header(header, compressed.size());
+
+        block.resize(header.original_file_size);
+        huffman_decode_span_multisymbol(compressed, header.compressed_data_size, block,
+                                        huffman_build_decode_table(canonical_code_table(header.code_lengths)));
+
+        write_full(output_fd, block);
+        total_output_size += block.size();
+    }
+
+    return total_output_size;
+}
+
+static uint64_t decode_streaming_file(const std::string& input_file, const std::string& output_file) {
+    const int input_fd = open(input_file.c_str(), O_RDONLY);
+    if (input_fd < 0)
+        throw std::runtime_error("Failed to open input file");
+
+    const int output_fd = open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output_fd < 0) {
+        close(input_fd);
+        throw std::runtime_error("Failed to open output file");
+    }
+
+    try {
+        const uint64_t total_output_size = huffman_decode_stream(input_fd, output_fd);
+        close(input_fd);
+        close(output_fd);
+        return total_output_size;
+    } catch (const std::exception& e) {
+        close(input_fd);
+        close(output_fd);
+        throw;
+    }
+}
+
+uint64_t huffman_decode_file(const std::string& input_file, const std::string& output_file) {
+    const MappedFile input = MappedFile::open_for_reading(input_file);
+    const std::span<const std::byte> input_data = input.data();
+
+    const HuffmanFormat format = detect_format(input_data);
+    size_t offset = format == HuffmanFormat::LEGACY ? 0 : sizeof(HuffmanFileTag);
+
+    if (format == HuffmanFormat::STREAMING)
+        return decode_streaming_file(input_file, output_file);
+
+    if (format == HuffmanFormat::ADAPTIVE)
+        return decode_adaptive_file(input_data, output_file);
+
+    if (format == HuffmanFormat::COMPACT)
+        return decode_compact_file(input_data, output_file);
+
+    if (format == HuffmanFormat::STORED) {
+        uint64_t original_file_size;
+        if (input_data.size() < HUFFMAN_STORED_HEADER_SIZE)
+            throw std::runtime_error("Input file too small to contain header");
+        std::memcpy(&original_file_size, input_data.data() + sizeof(HuffmanFileTag), sizeof(original_file_size));
+        if (input_data.size() - HUFFMAN_STORED_HEADER_SIZE != original_file_size)
+            throw std::runtime_error("Stored data size does not match its header");
+
+        MappedFile output = MappedFile::create(output_file, original_file_size);
+        if (original_file_size > 0)
+            std::memcpy(output.writable_data().data(), input_data.data() + HUFFMAN_STORED_HEADER_SIZE, original_file_size);
+        return original_file_size;
+    }
+
+    if (format != HuffmanFormat::LEGACY && format != HuffmanFormat::INDEXED && format != HuffmanFormat::MULTISTREAM)
+        throw std::runtime_error("Unsupported huffman file format version");
+
+    if (input_data.size() < offset + sizeof(HuffmanHeader))
+        throw std::runtime_error("Input file too small to contain header");
+
+    HuffmanHeader header;
+    std::memcpy(&header, input_data.data() + offset, sizeof(header));
+    offset += sizeof(header);
+
+    std::vector<uint64_t> index;
+    HuffmanIndexHeader index_header{0, 0};
+    if (format == HuffmanFormat::INDEXED) {
+        if (input_data.size() < offset + sizeof(index_header))
+            throw std::runtime_error("Input file too small to contain the block index");
+        std::memcpy(&index_header, input_data.data() + offset, sizeof(index_header));
+        offset += sizeof(index_header);
+
+        if (index_header.interval == 0 ||
+            index_header.num_entries != (header.original_file_size + index_header.interval - 1) / index_header.interval ||
+            (input_data.size() - offset) / sizeof(uint64_t) < index_header.num_entries)
+            throw std::runtime_error("Invalid block index");
+
+        index.resize(index_header.num_entries);
+        std::memcpy(index.data(), input_data.data() + offset, index.size() * sizeof(uint64_t));
+        offset += index.size() * sizeof(uint64_t);
+    }
+
+    std::vector<uint64_t> stream_sizes;
+    if (format == HuffmanFormat::MULTISTREAM) {
+        HuffmanStreamsHeader streams_header;
+        if (input_data.size() < offset + sizeof(streams_header))
+            throw std::runtime_error("Input file too small to contain the stream sizes");
+        std::memcpy(&streams_header, input_data.data() + offset, sizeof(streams_header));
+        offset += sizeof(streams_header);
+
+        if ((input_data.size() - offset) / sizeof(uint64_t) < streams_header.num_streams)
+            throw std::runtime_error("Input file too small to contain the stream sizes");
+
+        stream_sizes.resize(streams_header.num_streams);
+        std::memcpy(stream_sizes.data(), input_data.data() + offset, stream_sizes.size() * sizeof(uint64_t));
+        offset += stream_sizes.size() * sizeof(uint64_t);
+    }
+
+    validate_header(header, input_data.size() - offset);
+
+    const HuffmanDecodeTable decode_table = huffman_build_decode_table(canonical_code_table(header.code_lengths));
+
+    MappedFile output = MappedFile::create(output_file, header.original_file_size);
+
+    const std::span<const std::byte> source_span = input_data.subspan(offset, bits_to_bytes(header.compressed_data_size));
+    const std::span<std::byte> dest_span = output.writable_data();
+
+    // The actual decoding is done here
+    if (format == HuffmanFormat::INDEXED)
+        huffman_decode_span_parallel(source_span, header.compressed_data_size, dest_span, decode_table, index, index_header.interval);
+    else if (format == HuffmanFormat::MULTISTREAM)
+        huffman_decode_span_multistream(source_span, stream_sizes, dest_span, decode_table);
+    else
+        huffman_decode_span_multisymbol(source_span, header.compressed_data_size, dest_span, decode_table);
+
+    return header.original_file_size;
+}
@@ -2,6 +2,7 @@
 #include "huffman_node.h"
 
 #include <omp.h>
+#include <cstring>
 
 /*
  * Histogram function variants with different optimization levels:
@@ -14,6 +15,8 @@
  * | histogram_fast          | ✅          | ✅             | ✅         |
  *
  * SIMD Merge: Uses #pragma omp simd to vectorize the histogram merge loop
+ *
+ * histogram_fast counts into several sub-tables per thread (see histogram_subtables).
  */
 
 std::array<uint64_t, 256> histogram(std::span<const std::byte> data) {
@@ -113,7 +116,64 @@ std::array<uint64_t, 256> histogram_parallel_64bit(std::span<const std::byte> da
     return freqs;
 }
 
-std::array<uint64_t, 256> histogram_fast(std::span<const std::byte> data) {
+// Counting every byte into one table makes a run of equal bytes a chain of increments on the same counter, each
+// waiting for the store of the previous one. The loop below spreads consecutive bytes over HISTOGRAM_SUB_TABLES
+// tables of 32-bit counters and add them up at the end. The counters are flushed into the 64-bit result every
+// HISTOGRAM_FLUSH_INTERVAL bytes so they can't overflow. 8 tables were no faster than 4 on runs and slower on
+// random data.
+constexpr size_t HISTOGRAM_SUB_TABLES = 4;
+constexpr size_t HISTOGRAM_FLUSH_INTERVAL = size_t{1} << 30;
+using HistogramSubTables = std::array<std::array<uint32_t, 256>, HISTOGRAM_SUB_TABLES>;
+
+static inline void count_word(HistogramSubTables& tables, const uint64_t word) {
+    tables[0][(word >>  0) & 0xFF]++;
+    tables[1][(word >>  8) & 0xFF]++;
+    tables[2][(word >> 16) & 0xFF]++;
+    tables[3][(word >> 24) & 0xFF]++;
+    tables[0][(word >> 32) & 0xFF]++;
+    tables[1][(word >> 40) & 0xFF]++;
+    tables[2][(word >> 48) & 0xFF]++;
+    tables[3][(word >> 56) & 0xFF]++;
+}
+
+// A vector kernel (AVX-512 conflict detection with gather/scatter) measured about 0.85 GB/s against 1.2 GB/s for
+// this loop on random, zero and skewed data, so the scalar sub-tables are the engine on every CPU.
+static size_t count_words(const std::byte* data, const size_t size, HistogramSubTables& tables) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        count_word(tables, word);
+    }
+    return i;
+}
+
+// Counts one thread's share of the data a word at a time, the remaining bytes are counted one by one.
+static void histogram_chunk(const std::byte* data, const size_t size, std::array<uint64_t, 256>& freqs) {
+    HistogramSubTables tables;
+
+    for (size_t block_start = 0; block_start < size; block_start += HISTOGRAM_FLUSH_INTERVAL) {
+        const std::byte* block = data + block_start;
+        const size_t block_size = std::min(HISTOGRAM_FLUSH_INTERVAL, size - block_start);
+        for (auto& table : tables) {
+            table.fill(0);
+        }
+
+        size_t done = count_words(block, block_size, tables);
+        for (; done < block_size; ++done) {
+            tables[0][static_cast<uint8_t>(block[done])]++;
+        }
+
+        for (const auto& table : tables) {
+            #pragma omp simd
+            for (size_t bin = 0; bin < 256; ++bin) {
+                freqs[bin] += table[bin];
+            }
+        }
+    }
+}
+
+std::array<uint64_t, 256> histogram_subtables(std::span<const std::byte> data) {
     const int num_threads = omp_get_max_threads();
     std::vector<std::array<uint64_t, 256>> partial_freqs(num_threads);
 
@@ -125,36 +185,10 @@ std::array<uint64_t, 256> histogram_fast(std::span<const std::byte> data) {
         auto& local_freqs = partial_freqs[thread_id];
         local_freqs.fill(0);
 
-        const size_t start = thread_id * chunk_size;
+        const size_t start = std::min(thread_id * chunk_size, data.size());
         const size_t end = std::min(start + chunk_size, data.size());
 
-        const auto* ptr = reinterpret_cast<const uint64_t*>(data.data() + start);
-        size_t remaining = end - start;
-
-        // Process 8 bytes at a time
-        while (remaining >= 8) {
-            uint64_t word = *ptr;
-
-            local_freqs[(word >>  0) & 0xFF]++;
-            local_freqs[(word >>  8) & 0xFF]++;
-            local_freqs[(word >> 16) & 0xFF]++;
-            local_freqs[(word >> 24) & 0xFF]++;
-            local_freqs[(word >> 32) & 0xFF]++;
-            local_freqs[(word >> 40) & 0xFF]++;
-            local_freqs[(word >> 48) & 0xFF]++;
-            local_freqs[(word >> 56) & 0xFF]++;
-
-            ptr++;
-            remaining -= 8;
-        }
-
-        // Handle remaining bytes
-        const auto* byte_ptr = reinterpret_cast<const uint8_t*>(ptr);
-        while (remaining > 0) {
-            local_freqs[*byte_ptr]++;
-            byte_ptr++;
-            remaining--;
-        }
+        histogram_chunk(data.data() + start, end - start, local_freqs);
     }
 
     std::array<uint64_t, 256> freqs = partial_freqs[0];
@@ -166,4 +200,8 @@ std::array<uint64_t, 256> histogram_fast(std::span<const std::byte> data) {
     }
 
     return freqs;
-}
\ No newline at end of file
+}
+
+std::array<uint64_t, 256> histogram_fast(std::span<const std::byte> data) {
+    return histogram_subtables(data);
+}
@@ -1,6 +1,8 @@
 #include "huffman.h"
 
 #include <queue>
+#include <algorithm>
+#include <stdexcept>
 #include <omp.h>
 
 struct NodeComparator {
@@ -48,4 +50,89 @@ std::vector<HuffmanNode> huffman_tree(const std::array<uint64_t, 256>& hist) {
 
     // the remaining node is the root, always at nodes.size() - 1
     return nodes;
-}
\ No newline at end of file
+}
+
+// Package-merge (Larmore & Hirschberg): optimal code lengths under the constraint that no code is longer than
+// max_code_len bits. Each level holds the leaves merged with the "packages" (adjacent pairs) of the level below it.
+// Selecting the cheapest 2n - 2 items at the top level, and recursively the items its packages were built from,
+// gives every symbol a length equal to the number of times it was selected.
+std::array<uint16_t, 256> huffman_code_lengths(const std::array<uint64_t, 256>& hist, const size_t max_code_len) {
+    std::array<uint16_t, 256> code_lengths = {};
+
+    struct Item {
+        uint64_t weight;
+        int symbol; // -1 for packages
+    };
+
+    std::vector<Item> leaves;
+    leaves.reserve(256);
+    for (size_t i = 0; i < hist.size(); i++) {
+        if (hist[i] != 0)
+            leaves.push_back({hist[i], static_cast<int>(i)});
+    }
+
+    if (leaves.empty())
+        return code_lengths;
+
+    if (leaves.size() == 1) {
+        // special case: only one symbol, it still needs a 1 bit code (same as huffman_dict)
+        code_lengths[leaves[0].symbol] = 1;
+        return code_lengths;
+    }
+
+    if (max_code_len == 0 || max_code_len > MAX_CODE_LEN || (size_t{1} << max_code_len) < leaves.size())
+        throw std::invalid_argument("max_code_len cannot fit all symbols or exceeds MAX_CODE_LEN");
+
+    std::stable_sort(leaves.begin(), leaves.end(), [](const Item& a, const Item& b) {
+        return a.weight < b.weight;
+    });
+
+    // levels[0] is the deepest level (leaves only), levels[max_code_len - 1] is the top one
+    std::vector<std::vector<Item>> levels;
+    levels.reserve(max_code_len);
+    levels.push_back(leaves);
+
+    for (size_t level = 1; level < max_code_len; level++) {
+        const std::vector<Item>& below = levels.back();
+
+        std::vector<Item> merged;
+        merged.reserve(leaves.size() + below.size() / 2);
+
+        size_t leaf_idx = 0;
+        size_t package_idx = 0;
+        const size_t num_packages = below.size() / 2;
+
+        while (leaf_idx < leaves.size() || package_idx < num_packages) {
+            const bool take_leaf = package_idx == num_packages ||
+                (leaf_idx < leaves.size() &&
+                 leaves[leaf_idx].weight <= below[2 * package_idx].weight + below[2 * package_idx + 1].weight);
+
+            if (take_leaf) {
+                merged.push_back(leaves[leaf_idx++]);
+            } else {
+                merged.push_back({below[2 * package_idx].weight + below[2 * package_idx + 1].weight, -1});
+                package_idx++;
+            }
+        }
+
+        levels.push_back(std::move(merged));
+    }
+
+    // walk down from the top level; the first k packages of a level are always built from the first 2k items below
+    size_t selected = 2 * leaves.size() - 2;
+    for (size_t level = levels.size(); level > 0 && selected > 0; level--) {
+        const std::vector<Item>& items = levels[level - 1];
+        size_t packages = 0;
+
+        for (size_t i = 0; i < selected; i++) {
+            if (items[i].symbol >= 0)
+                code_lengths[items[i].symbol]++;
+            else
+                packages++;
+        }
+
+        selected = 2 * packages;
+    }
+
+    return code_lengths;
+}
@@ -0,0 +1,67 @@
+#include "object_id.h"
+
+#include <stdexcept>
+
+constexpr size_t SHA1_SIZE = 20;
+
+static bool is_object_id_size(const size_t size) {
+    return size == SHA1_SIZE || size == ObjectId::MAX_SIZE;
+}
+
+static int hex_value(const char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+std::optional<ObjectId> ObjectId::from_hex(std::string_view hex) {
+    if (hex.size() % 2 != 0 || !is_object_id_size(hex.size() / 2))
+        return std::nullopt;
+
+    ObjectId id;
+    id.digest_size = hex.size() / 2;
+    for (size_t i = 0; i < id.digest_size; ++i) {
+        const int high = hex_value(hex[2 * i]);
+        const int low = hex_value(hex[2 * i + 1]);
+        if (high < 0 || low < 0)
+            return std::nullopt;
+
+        id.digest[i] = static_cast<std::byte>(high << 4 | low);
+    }
+
+    return id;
+}
+
+ObjectId ObjectId::parse_hex(std::string_view hex) {
+    std::optional<ObjectId> id = from_hex(hex);
+    if (!id)
+        throw std::invalid_argument("Invalid object hash: " + std::string(hex));
+
+    return *id;
+}
+
+std::optional<ObjectId> ObjectId::from_bytes(std::span<const std::byte> bytes) {
+    if (!is_object_id_size(bytes.size()))
+        return std::nullopt;
+
+    ObjectId id;
+    id.digest_size = bytes.size();
+    std::memcpy(id.digest.data(), bytes.data(), bytes.size());
+
+    return id;
+}
+
+std::string ObjectId::to_hex() const {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+    std::string hex(digest_size * 2, '\0');
+    for (size_t i = 0; i < digest_size; ++i) {
+        const uint8_t byte = static_cast<uint8_t>(digest[i]);
+        hex[2 * i] = HEX_DIGITS[byte >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[byte & 0xF];
+    }
+
+    return hex;
+}
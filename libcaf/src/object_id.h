@@ -0,0 +1,58 @@
+#ifndef OBJECT_ID_H
+#define OBJECT_ID_H
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// The raw digest naming an object: 20 bytes for SHA-1 or 32 for SHA-256 and BLAKE3. It's stored inline, so copying,
+// comparing and hashing one never allocates and the comparisons are a memcmp.
+class ObjectId {
+public:
+    static constexpr size_t MAX_SIZE = 32;
+
+    // Parses the lowercase hex form that hash_object and save_file_content return. Anything else, including hashes
+    // of other lengths, has no ObjectId.
+    static std::optional<ObjectId> from_hex(std::string_view hex);
+    static ObjectId parse_hex(std::string_view hex); // like from_hex, throws std::invalid_argument when there's no id
+    static std::optional<ObjectId> from_bytes(std::span<const std::byte> bytes);
+
+    std::string to_hex() const;
+
+    std::span<const std::byte> bytes() const { return {digest.data(), digest_size}; }
+    size_t size() const { return digest_size; }
+
+    bool operator==(const ObjectId& other) const {
+        return digest_size == other.digest_size && std::memcmp(digest.data(), other.digest.data(), digest_size) == 0;
+    }
+    std::strong_ordering operator<=>(const ObjectId& other) const {
+        const int order = std::memcmp(digest.data(), other.digest.data(), std::min(digest_size, other.digest_size));
+        return order != 0 ? order <=> 0 : digest_size <=> other.digest_size;
+    }
+
+private:
+    ObjectId() = default;
+
+    std::array<std::byte, MAX_SIZE> digest{};
+    uint8_t digest_size = 0;
+};
+
+template <>
+struct std::hash<ObjectId> {
+    // The digest is already uniformly distributed, so its first bytes are a good hash
+    size_t operator()(const ObjectId& id) const noexcept {
+        size_t value;
+        std::memcpy(&value, id.bytes().data(), sizeof(value));
+        return value;
+    }
+};
+
+#endif // OBJECT_ID_H
@@ -1,158 +1,278 @@
 #include <string>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/file.h>
 #include <vector>
 #include <cstring>
 #include <stdexcept>
 #include <map>
+#include <optional>
+#include <span>
 
 #include "caf.h"
 #include "object_io.h"
 #include "hash_types.h"
+#include "object_id.h"
 
 // Maximum string length for length-prefixed strings
 constexpr uint32_t MAX_LENGTH = 1024 * 1024;  // 1 MB limit for strings
 
-std::string read_length_prefixed_string(int fd); // Helper function to read a length-prefixed string safely
-void write_with_length(int fd, const std::string &data); // Helper function to write a length-prefixed string safely
-void save_tree_record(int fd, const TreeRecord &record); // Helper function to serialize a TreeRecord
-TreeRecord load_tree_record(int fd); // Helper function to deserialize a TreeRecord
+// Objects are serialized into a buffer and written with a single write, and read back whole with a single read and
+// parsed from memory, so the cost of a large tree doesn't grow with the number of its fields.
+
+// Bounds checked cursor over the bytes of a loaded object
+class ObjectReader {
+public:
+    explicit ObjectReader(std::span<const std::byte> data) : data(data), offset(0) {}
+
+    template <typename T>
+    T read_value(const char *error_message);
+    std::span<const std::byte> read_bytes(size_t size, const char *error_message);
+    std::string read_length_prefixed_string(); // Reads a length-prefixed string safely
+    ObjectId read_hash(); // Reads a hash field
+    std::optional<ObjectId> read_optional_hash(); // Reads a hash field, an empty one is no hash
+    ObjectId read_legacy_hash(); // Reads a length-prefixed hex hash
+    std::optional<ObjectId> read_optional_legacy_hash(); // Reads a length-prefixed hex hash, an empty one is no hash
+    uint8_t read_version(const std::array<char, 7> &magic); // Reads the tag, or returns 0 for the legacy layout
+
+private:
+    std::span<const std::byte> data;
+    size_t offset;
+};
+
+void append_bytes(std::vector<std::byte> &buffer, const void *data, size_t size); // Helper function to append raw bytes
+void write_with_length(std::vector<std::byte> &buffer, const std::string &data); // Helper function to append a length-prefixed string
+void write_hash(std::vector<std::byte> &buffer, const std::optional<ObjectId> &hash); // Helper function to append a hash field
+void write_tag(std::vector<std::byte> &buffer, const std::array<char, 7> &magic); // Helper function to append the object tag
+void save_tree_record(std::vector<std::byte> &buffer, const TreeRecord &record); // Helper function to serialize a TreeRecord
+TreeRecord load_tree_record(ObjectReader &reader, uint8_t version); // Helper function to deserialize a TreeRecord
+void write_object(const std::string &root_dir, const std::string &hash, const std::vector<std::byte> &buffer); // Helper function to store a serialized object
+
+// Keyed by the root directory and hash of the object
+static LruCache<std::string, std::shared_ptr<Commit>> commit_cache(DEFAULT_OBJECT_CACHE_SIZE);
+static LruCache<std::string, std::shared_ptr<Tree>> tree_cache(DEFAULT_OBJECT_CACHE_SIZE);
 
 // Serialize Commit to disk
-void save_commit(const std::string &root_dir, const Commit &commit) {
-    std::string commit_hash = hash_object(commit);
-
-    int fd = open_content_for_writing(root_dir, commit_hash);
-
-    try {
-        write_with_length(fd, commit.tree_hash);
-        write_with_length(fd, commit.author);
-        write_with_length(fd, commit.message);
-
-        if (write(fd, &commit.timestamp, sizeof(commit.timestamp)) != sizeof(commit.timestamp))
-            throw std::runtime_error("Failed to write timestamp");
-
-        if (commit.parent) {
-            write_with_length(fd, *commit.parent);
-        } else {
-            uint32_t length = 0;
-            if (write(fd, &length, sizeof(length)) != sizeof(length))
-                throw std::runtime_error("Failed to write parent");
-        }
-
-        flock(fd, LOCK_UN);
-        close(fd);
-    } catch (const std::exception &e) {
-        delete_content(root_dir, commit_hash);
-        throw;
-    }
+void save_commit(const std::string &root_dir, const Commit &commit, const HashAlgorithm algorithm) {
+    std::string commit_hash = hash_object(commit, algorithm);
+
+    std::vector<std::byte> buffer;
+    write_tag(buffer, COMMIT_MAGIC);
+    write_hash(buffer, commit.tree_hash);
+    write_with_length(buffer, commit.author);
+    write_with_length(buffer, commit.message);
+    append_bytes(buffer, &commit.timestamp, sizeof(commit.timestamp));
+    write_hash(buffer, commit.parent);
+
+    write_object(root_dir, commit_hash, buffer);
 }
 
 // Deserialize Commit from disk
-Commit load_commit(const std::string &root_dir, const std::string &commit_hash) {
-    int fd = open_content_for_reading(root_dir, commit_hash);
-
-    std::string tree_hash = read_length_prefixed_string(fd);
-    std::string author = read_length_prefixed_string(fd);
-    std::string message = read_length_prefixed_string(fd);
+std::shared_ptr<Commit> load_commit(const std::string &root_dir, const std::string &commit_hash) {
+    const std::string cache_key = root_dir + "/" + commit_hash;
+    if (std::optional<std::shared_ptr<Commit>> cached = commit_cache.get(cache_key))
+        return *cached;
 
-    uint64_t timestamp;
-    if (read(fd, &timestamp, sizeof(timestamp)) != sizeof(timestamp))
-        throw std::runtime_error("Failed to read timestamp");
+    std::vector<std::byte> data = read_content(root_dir, commit_hash);
+    ObjectReader reader(data);
 
-    std::string parent_str = read_length_prefixed_string(fd);
+    uint8_t version = reader.read_version(COMMIT_MAGIC);
+    ObjectId tree_hash = version == 0 ? reader.read_legacy_hash() : reader.read_hash();
+    std::string author = reader.read_length_prefixed_string();
+    std::string message = reader.read_length_prefixed_string();
+    uint64_t timestamp = reader.read_value<uint64_t>("Failed to read timestamp");
+    std::optional<ObjectId> parent = version == 0 ? reader.read_optional_legacy_hash() : reader.read_optional_hash();
 
-    flock(fd, LOCK_UN);
-    close(fd);
+    auto commit = std::make_shared<Commit>(tree_hash, author, message, timestamp, parent);
+    commit_cache.put(cache_key, commit);
 
-    std::optional<std::string> parent = parent_str.empty() ? std::nullopt : std::make_optional(parent_str);
-    return Commit(tree_hash, author, message, timestamp, parent);
+    return commit;
 }
 
-void save_tree(const std::string &root_dir, const Tree &tree) {
-    std::string tree_hash = hash_object(tree);
-
-    int fd = open_content_for_writing(root_dir, tree_hash);
-
-     try {
-        uint32_t num_records = tree.records.size();
-        if (write(fd, &num_records, sizeof(num_records)) != sizeof(num_records))
-            throw std::runtime_error("Failed to write number of records");
+void save_tree(const std::string &root_dir, const Tree &tree, const HashAlgorithm algorithm) {
+    std::string tree_hash = hash_object(tree, algorithm);
 
-        for (const auto &[name, record] : tree.records) {
-            save_tree_record(fd, record);
-        }
+    std::vector<std::byte> buffer;
+    write_tag(buffer, TREE_MAGIC);
+    uint32_t num_records = tree.records.size();
+    append_bytes(buffer, &num_records, sizeof(num_records));
 
-        flock(fd, LOCK_UN);
-        close(fd);
-    } catch (const std::exception &e) {
-        delete_content(root_dir, tree_hash);
-        throw;
+    for (const auto &[name, record] : tree.records) {
+        save_tree_record(buffer, record);
     }
+
+    write_object(root_dir, tree_hash, buffer);
 }
 
-Tree load_tree(const std::string &root_dir, const std::string &tree_hash) {
-    int fd = open_content_for_reading(root_dir.c_str(), tree_hash.c_str());
+std::shared_ptr<Tree> load_tree(const std::string &root_dir, const std::string &tree_hash) {
+    const std::string cache_key = root_dir + "/" + tree_hash;
+    if (std::optional<std::shared_ptr<Tree>> cached = tree_cache.get(cache_key))
+        return *cached;
+
+    std::vector<std::byte> data = read_content(root_dir, tree_hash);
+    ObjectReader reader(data);
 
-    uint32_t num_records;
-    if (read(fd, &num_records, sizeof(num_records)) != sizeof(num_records))
-        throw std::runtime_error("Failed to read the number of records");
+    uint8_t version = reader.read_version(TREE_MAGIC);
+    uint32_t num_records = reader.read_value<uint32_t>("Failed to read the number of records");
 
     std::map<std::string, TreeRecord> records;
     for (uint32_t i = 0; i < num_records; ++i) {
-        TreeRecord record = load_tree_record(fd);
+        TreeRecord record = load_tree_record(reader, version);
         records.emplace(record.name, record);
     }
 
-    flock(fd, LOCK_UN);
-    close(fd);
+    auto tree = std::make_shared<Tree>(records);
+    tree_cache.put(cache_key, tree);
 
-    return Tree(records);
+    return tree;
 }
 
-std::string read_length_prefixed_string(int fd) {
-    uint32_t length;
-    if (read(fd, &length, sizeof(length)) != sizeof(length))
-        throw std::runtime_error("Failed to read length");
+void set_object_cache_size(const size_t size) {
+    commit_cache.set_capacity(size);
+    tree_cache.set_capacity(size);
+}
+
+ObjectCacheStats object_cache_stats() {
+    return {tree_cache.stats(), commit_cache.stats()};
+}
+
+void clear_object_cache() {
+    commit_cache.clear();
+    tree_cache.clear();
+}
+
+template <typename T>
+T ObjectReader::read_value(const char *error_message) {
+    if (data.size() - offset < sizeof(T))
+        throw std::runtime_error(error_message);
+
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+
+    return value;
+}
+
+std::span<const std::byte> ObjectReader::read_bytes(size_t size, const char *error_message) {
+    if (data.size() - offset < size)
+        throw std::runtime_error(error_message);
+
+    std::span<const std::byte> bytes = data.subspan(offset, size);
+    offset += size;
+
+    return bytes;
+}
+
+std::string ObjectReader::read_length_prefixed_string() {
+    uint32_t length = read_value<uint32_t>("Failed to read length");
 
     if (length > MAX_LENGTH)
         throw std::runtime_error("Length exceeds maximum");
 
-    std::string result(length, '\0');
+    std::span<const std::byte> bytes = read_bytes(length, "Failed to read string");
+    return std::string(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+ObjectId ObjectReader::read_hash() {
+    std::optional<ObjectId> id = read_optional_hash();
+    if (!id)
+        throw std::runtime_error("Missing hash");
+
+    return *id;
+}
+
+std::optional<ObjectId> ObjectReader::read_optional_hash() {
+    uint8_t size = read_value<uint8_t>("Failed to read hash size");
+    if (size == 0)
+        return read_optional_legacy_hash();
 
-    if (read(fd, &result[0], length) != static_cast<ssize_t>(length))
-        throw std::runtime_error("Failed to read string");
+    std::optional<ObjectId> id = ObjectId::from_bytes(read_bytes(size, "Failed to read hash"));
+    if (!id)
+        throw std::runtime_error("Invalid hash size");
 
-    return result;
+    return id;
 }
 
-void write_with_length(int fd, const std::string &data) {
+ObjectId ObjectReader::read_legacy_hash() {
+    std::optional<ObjectId> id = read_optional_legacy_hash();
+    if (!id)
+        throw std::runtime_error("Missing hash");
+
+    return *id;
+}
+
+std::optional<ObjectId> ObjectReader::read_optional_legacy_hash() {
+    std::string hex = read_length_prefixed_string();
+    if (hex.empty())
+        return std::nullopt;
+
+    std::optional<ObjectId> id = ObjectId::from_hex(hex);
+    if (!id)
+        throw std::runtime_error("Invalid hash");
+
+    return id;
+}
+
+uint8_t ObjectReader::read_version(const std::array<char, 7> &magic) {
+    ObjectFileTag tag;
+    if (data.size() < sizeof(tag))
+        return 0;
+
+    std::memcpy(&tag, data.data(), sizeof(tag));
+    if (tag.magic != magic)
+        return 0;
+
+    if (tag.version == 0 || tag.version > OBJECT_FORMAT_VERSION)
+        throw std::runtime_error("Unsupported object format version");
+
+    offset = sizeof(tag);
+    return tag.version;
+}
+
+void append_bytes(std::vector<std::byte> &buffer, const void *data, size_t size) {
+    const std::byte *bytes = static_cast<const std::byte *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+void write_with_length(std::vector<std::byte> &buffer, const std::string &data) {
     uint32_t length = data.length();
-    if (write(fd, &length, sizeof(length)) != sizeof(length) || write(fd, data.c_str(), length) != static_cast<ssize_t>(length)) {
-        throw std::runtime_error("Failed to write string");
+    append_bytes(buffer, &length, sizeof(length));
+    append_bytes(buffer, data.data(), length);
+}
+
+void write_hash(std::vector<std::byte> &buffer, const std::optional<ObjectId> &hash) {
+    if (!hash) {
+        uint8_t size = 0;
+        append_bytes(buffer, &size, sizeof(size));
+        write_with_length(buffer, "");
+        return;
     }
+
+    uint8_t size = hash->size();
+    append_bytes(buffer, &size, sizeof(size));
+    append_bytes(buffer, hash->bytes().data(), size);
+}
+
+void write_tag(std::vector<std::byte> &buffer, const std::array<char, 7> &magic) {
+    ObjectFileTag tag = {magic, OBJECT_FORMAT_VERSION};
+    append_bytes(buffer, &tag, sizeof(tag));
 }
 
-void save_tree_record(int fd, const TreeRecord &record) {
+void save_tree_record(std::vector<std::byte> &buffer, const TreeRecord &record) {
     uint8_t type = static_cast<uint8_t>(record.type);
-    if (write(fd, &type, sizeof(type)) != sizeof(type))
-        throw std::runtime_error("Failed to write type");
+    append_bytes(buffer, &type, sizeof(type));
 
-    write_with_length(fd, record.hash);
-    write_with_length(fd, record.name);
+    write_hash(buffer, record.hash);
+    write_with_length(buffer, record.name);
 }
 
-TreeRecord load_tree_record(int fd) {
-    uint8_t type;
-
-    if (read(fd, &type, sizeof(type)) != sizeof(type)) {
-        throw std::runtime_error("Failed to read TreeRecord type");
-    }
+TreeRecord load_tree_record(ObjectReader &reader, uint8_t version) {
+    uint8_t type = reader.read_value<uint8_t>("Failed to read TreeRecord type");
 
     TreeRecord::Type record_type = static_cast<TreeRecord::Type>(type);
-    std::string hash = read_length_prefixed_string(fd);
-    std::string name = read_length_prefixed_string(fd);
+    ObjectId hash = version == 0 ? reader.read_legacy_hash() : reader.read_hash();
+    std::string name = reader.read_length_prefixed_string();
 
     return TreeRecord(record_type, hash, name);
-}
\ No newline at end of file
+}
+
+void write_object(const std::string &root_dir, const std::string &hash, const std::vector<std::byte> &buffer) {
+    save_content(root_dir, hash, buffer);
+}
@@ -6,14 +6,66 @@
 #include <vector>
 #include <stdexcept>
 #include <cstdint>
+#include <array>
+#include <memory>
 
 #include "commit.h"
 #include "tree.h"
+#include "hash_algorithm.h"
+#include "util/lru_cache.h"
 
-void save_commit(const std::string &root_dir, const Commit &commit);
-Commit load_commit(const std::string &root_dir, const std::string &hash);
-void save_tree(const std::string &root_dir, const Tree &tree);
-Tree load_tree(const std::string &root_dir, const std::string &hash);
+/*
+    Trees and commits are written in the tagged layout and read in either layout.
+
+    tagged layout (OBJECT_FORMAT_VERSION), hashes are hash fields:
+
+    [8 bytes]   : ObjectFileTag, TREE_MAGIC or COMMIT_MAGIC and the format version
+    tree        : [4 bytes] uint32_t number of records, then for every record
+                  [1 byte] type, hash field, length-prefixed name
+    commit      : hash field of the tree, length-prefixed author and message, [8 bytes] timestamp,
+                  hash field of the parent, an empty string without a parent
+
+    A hash field is [1 byte] the size of an ObjectId and its raw bytes, or [1 byte] 0 and a length-prefixed string,
+    empty for a commit without a parent and otherwise read as a hex hash. Strings are prefixed with their uint32_t
+    length.
+
+    legacy layout (version 0), every hash is a length-prefixed string:
+
+    tree        : [4 bytes] uint32_t number of records, then for every record
+                  [1 byte] type, length-prefixed hash, length-prefixed name
+    commit      : length-prefixed tree hash, author and message, [8 bytes] timestamp, length-prefixed parent
+
+    Read as the little endian count or length that starts a legacy object, the magic is over a billion, more records
+    than a legacy tree of any practical size holds and more than the longest string allowed, so the two can't be
+    confused.
+*/
+
+constexpr uint8_t OBJECT_FORMAT_VERSION = 1;
+
+constexpr std::array<char, 7> TREE_MAGIC = {'C', 'A', 'F', 'T', 'R', 'E', 'E'};
+constexpr std::array<char, 7> COMMIT_MAGIC = {'C', 'A', 'F', 'C', 'O', 'M', 'T'};
+struct ObjectFileTag {
+    std::array<char, 7> magic;
+    uint8_t version;
+};
+
+// Loaded trees and commits are kept in an LRU cache of the process, each holding up to the object cache size objects,
+// and shared by every load of the same object. Objects never change so the cache is never invalidated.
+constexpr size_t DEFAULT_OBJECT_CACHE_SIZE = 4096;
+
+void save_commit(const std::string &root_dir, const Commit &commit, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+std::shared_ptr<Commit> load_commit(const std::string &root_dir, const std::string &hash);
+void save_tree(const std::string &root_dir, const Tree &tree, const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+std::shared_ptr<Tree> load_tree(const std::string &root_dir, const std::string &hash);
+
+struct ObjectCacheStats {
+    LruCacheStats trees;
+    LruCacheStats commits;
+};
+
+void set_object_cache_size(const size_t size); // of each cache
+ObjectCacheStats object_cache_stats();
+void clear_object_cache();
 
 
 #endif // OBJECT_IO_H
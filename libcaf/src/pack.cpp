@@ -0,0 +1,275 @@
+#include "pack.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "caf.h"
+#include "util/fd_io.h"
+
+constexpr const char* PACK_EXTENSION = ".pack";
+constexpr const char* INDEX_EXTENSION = ".idx";
+
+constexpr size_t INDEX_IDS_OFFSET = sizeof(PackFileTag) + sizeof(PackIndexHeader) + PACK_FANOUT_SIZE * sizeof(uint32_t);
+
+template <typename T>
+static T read_at(std::span<const std::byte> data, const size_t offset) {
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+static bool has_tag(std::span<const std::byte> data, const std::array<char, 7>& magic) {
+    if (data.size() < sizeof(PackFileTag))
+        return false;
+
+    PackFileTag tag = read_at<PackFileTag>(data, 0);
+    return tag.magic == magic && tag.version == PACK_FORMAT_VERSION;
+}
+
+std::string pack_path_for_index(const std::string& index_path) {
+    return index_path.substr(0, index_path.size() - std::strlen(INDEX_EXTENSION)) + PACK_EXTENSION;
+}
+
+std::vector<std::string> list_pack_indexes(const std::string& content_root_dir) {
+    std::vector<std::string> indexes;
+
+    std::error_code ec;
+    std::filesystem::directory_iterator it(std::filesystem::path(content_root_dir) / PACK_DIR, ec);
+    if (ec) {
+        if (ec == std::errc::no_such_file_or_directory)
+            return indexes;
+        throw std::runtime_error("Failed to list packs: " + ec.message());
+    }
+
+    for (const auto& entry : it) {
+        if (entry.path().extension() == INDEX_EXTENSION && entry.path().filename().string()[0] != '.')
+            indexes.push_back(entry.path().string());
+    }
+
+    return indexes;
+}
+
+PackFile::PackFile(std::string index_path, ino_t index_ino, MappedFile index, MappedFile pack) :
+    index_path(std::move(index_path)), index_ino(index_ino), index(std::move(index)), pack(std::move(pack)),
+    num_objects(0), id_size(0) {}
+
+PackFile PackFile::open(const std::string& index_path) {
+    // the inode is taken before the index is mapped, if the index is replaced in between the mapping is of a newer
+    // index than the inode and the pack is only opened again
+    struct stat st;
+    if (stat(index_path.c_str(), &st) < 0)
+        throw std::runtime_error("Failed to stat pack index");
+
+    PackFile pack_file(index_path, st.st_ino, MappedFile::open_for_reading(index_path),
+                       MappedFile::open_for_reading(pack_path_for_index(index_path)));
+
+    std::span<const std::byte> index_data = pack_file.index.data();
+    if (!has_tag(index_data, PACK_INDEX_MAGIC) || index_data.size() < INDEX_IDS_OFFSET)
+        throw std::runtime_error("Invalid pack index");
+    if (!has_tag(pack_file.pack.data(), PACK_MAGIC))
+        throw std::runtime_error("Invalid pack");
+
+    PackIndexHeader header = read_at<PackIndexHeader>(index_data, sizeof(PackFileTag));
+    const size_t entry_size = header.id_size + sizeof(PackObjectLocation);
+    if (header.id_size == 0 || header.id_size > ObjectId::MAX_SIZE ||
+        (index_data.size() - INDEX_IDS_OFFSET) / entry_size != header.num_objects ||
+        (index_data.size() - INDEX_IDS_OFFSET) % entry_size != 0)
+        throw std::runtime_error("Invalid pack index");
+
+    const size_t fanout_offset = sizeof(PackFileTag) + sizeof(PackIndexHeader);
+    if (read_at<uint32_t>(index_data, fanout_offset + (PACK_FANOUT_SIZE - 1) * sizeof(uint32_t)) != header.num_objects)
+        throw std::runtime_error("Invalid pack index");
+
+    pack_file.num_objects = header.num_objects;
+    pack_file.id_size = header.id_size;
+
+    return pack_file;
+}
+
+std::optional<std::span<const std::byte>> PackFile::find(const ObjectId& id) const {
+    if (id.size() != id_size)
+        return std::nullopt;
+
+    std::span<const std::byte> index_data = index.data();
+    const size_t fanout_offset = sizeof(PackFileTag) + sizeof(PackIndexHeader);
+    const uint8_t first_byte = static_cast<uint8_t>(id.bytes()[0]);
+
+    size_t low = first_byte == 0 ? 0 : read_at<uint32_t>(index_data, fanout_offset + (first_byte - 1) * sizeof(uint32_t));
+    size_t high = read_at<uint32_t>(index_data, fanout_offset + first_byte * sizeof(uint32_t));
+    if (low > high || high > num_objects)
+        throw std::runtime_error("Invalid pack index");
+
+    const std::byte* ids = index_data.data() + INDEX_IDS_OFFSET;
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        const int order = std::memcmp(ids + middle * id_size, id.bytes().data(), id_size);
+        if (order == 0)
+            return object(middle);
+
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return std::nullopt;
+}
+
+ObjectId PackFile::id(const size_t i) const {
+    return *ObjectId::from_bytes(index.data().subspan(INDEX_IDS_OFFSET + i * id_size, id_size));
+}
+
+std::span<const std::byte> PackFile::object(const size_t i) const {
+    const size_t locations_offset = INDEX_IDS_OFFSET + num_objects * id_size;
+    PackObjectLocation location = read_at<PackObjectLocation>(index.data(),
+                                                              locations_offset + i * sizeof(PackObjectLocation));
+
+    if (location.offset < sizeof(PackFileTag) || location.offset > pack.size() ||
+        location.size > pack.size() - location.offset)
+        throw std::runtime_error("Invalid pack object location");
+
+    return pack.data().subspan(location.offset, location.size);
+}
+
+PackWriter::PackWriter(const std::string& content_root_dir) :
+    pack_dir((std::filesystem::path(content_root_dir) / PACK_DIR).string()), fd(-1), offset(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(pack_dir, ec);
+    if (ec)
+        throw std::runtime_error("Failed to create pack directory: " + ec.message());
+
+    temp_path = pack_dir + "/.pack-XXXXXX";
+    fd = mkstemp(temp_path.data());
+    if (fd < 0)
+        throw std::runtime_error("Failed to create temporary file");
+
+    try {
+        if (fchmod(fd, 0644) < 0)
+            throw std::runtime_error("Failed to set temporary file permissions");
+
+        PackFileTag tag = {PACK_MAGIC, PACK_FORMAT_VERSION};
+        write_full(fd, std::as_bytes(std::span(&tag, 1)));
+        offset = sizeof(tag);
+    } catch (const std::exception& e) {
+        close(fd);
+        unlink(temp_path.c_str());
+        throw;
+    }
+}
+
+PackWriter::PackWriter(PackWriter&& other) noexcept :
+    pack_dir(std::move(other.pack_dir)), temp_path(std::move(other.temp_path)), fd(other.fd), offset(other.offset),
+    entries(std::move(other.entries)) {
+    other.fd = -1;
+}
+
+PackWriter::~PackWriter() {
+    if (fd >= 0) {
+        close(fd);
+        unlink(temp_path.c_str());
+    }
+}
+
+void PackWriter::check_id_size(const ObjectId& id) const {
+    if (!entries.empty() && entries.front().id.size() != id.size())
+        throw std::invalid_argument("All the objects of a pack must have ids of the same size");
+}
+
+void PackWriter::add(const ObjectId& id, const int in_fd) {
+    check_id_size(id);
+
+    copy_fd(in_fd, fd);
+
+    const off_t end = lseek(fd, 0, SEEK_CUR);
+    if (end < 0)
+        throw std::runtime_error("Failed to get pack size");
+
+    entries.push_back({id, {offset, static_cast<uint64_t>(end) - offset}});
+    offset = end;
+}
+
+void PackWriter::add(const ObjectId& id, std::span<const std::byte> data) {
+    check_id_size(id);
+
+    write_full(fd, data);
+
+    entries.push_back({id, {offset, data.size()}});
+    offset += data.size();
+}
+
+std::string PackWriter::finish() {
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.id < b.id; });
+
+    const size_t id_size = entries.empty() ? ObjectId::MAX_SIZE : entries.front().id.size();
+
+    std::vector<std::byte> index_data;
+    index_data.reserve(INDEX_IDS_OFFSET + entries.size() * (id_size + sizeof(PackObjectLocation)));
+    const auto append = [&index_data](const void* data, const size_t size) {
+        const std::byte* bytes = static_cast<const std::byte*>(data);
+        index_data.insert(index_data.end(), bytes, bytes + size);
+    };
+
+    PackFileTag tag = {PACK_INDEX_MAGIC, PACK_FORMAT_VERSION};
+    append(&tag, sizeof(tag));
+    PackIndexHeader header = {entries.size(), id_size};
+    append(&header, sizeof(header));
+
+    std::array<uint32_t, PACK_FANOUT_SIZE> fanout{};
+    for (const Entry& entry : entries)
+        ++fanout[static_cast<uint8_t>(entry.id.bytes()[0])];
+    for (size_t b = 1; b < PACK_FANOUT_SIZE; ++b)
+        fanout[b] += fanout[b - 1];
+    append(fanout.data(), sizeof(fanout));
+
+    for (const Entry& entry : entries)
+        append(entry.id.bytes().data(), id_size);
+    for (const Entry& entry : entries)
+        append(&entry.location, sizeof(entry.location));
+
+    // the pack is named after its objects, so packing the same objects again gives the same pack
+    const std::string ids(reinterpret_cast<const char*>(index_data.data() + INDEX_IDS_OFFSET), entries.size() * id_size);
+    const std::string base_path = pack_dir + "/pack-" + hash_string(ids);
+
+    std::string temp_index_path = pack_dir + "/.idx-XXXXXX";
+    int index_fd = mkstemp(temp_index_path.data());
+    if (index_fd < 0)
+        throw std::runtime_error("Failed to create temporary file");
+
+    try {
+        if (fchmod(index_fd, 0644) < 0)
+            throw std::runtime_error("Failed to set temporary file permissions");
+        write_full(index_fd, index_data);
+        if (close(index_fd) < 0) {
+            index_fd = -1;
+            throw std::runtime_error("Failed to close pack index");
+        }
+        index_fd = -1;
+
+        if (close(fd) < 0) {
+            fd = -1;
+            throw std::runtime_error("Failed to close pack");
+        }
+        fd = -1;
+
+        // the index goes last, a pack is only looked at once its index exists
+        if (rename(temp_path.c_str(), (base_path + PACK_EXTENSION).c_str()) < 0)
+            throw std::runtime_error("Failed to move pack into place");
+        if (rename(temp_index_path.c_str(), (base_path + INDEX_EXTENSION).c_str()) < 0)
+            throw std::runtime_error("Failed to move pack index into place");
+    } catch (const std::exception& e) {
+        if (index_fd >= 0)
+            close(index_fd);
+        unlink(temp_index_path.c_str());
+        if (fd < 0)
+            unlink(temp_path.c_str());
+        throw;
+    }
+
+    return base_path + INDEX_EXTENSION;
+}
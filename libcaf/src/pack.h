@@ -0,0 +1,124 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "object_id.h"
+#include "util/mapped_file.h"
+
+/*
+    A pack holds many objects in one file so reading one costs no open, lock or directory lookup. Packs live in the
+    PACK_DIR directory of a content root as pack-<name>.pack and pack-<name>.idx, and never change once written.
+    Objects are stored as their loose files hold them, compressed objects stay compressed.
+
+    pack file:
+
+    [8 bytes]       : PackFileTag, PACK_MAGIC and the format version
+    [n bytes]       : the objects one after the other
+
+    index file, all the objects of a pack have ids of the same size:
+
+    [8 bytes]       : PackFileTag, PACK_INDEX_MAGIC and the format version
+    [16 bytes]      : PackIndexHeader
+    [1024 bytes]    : uint32_t fanout, entry b is the number of objects whose id starts with a byte <= b
+    [n * id_size]   : the ids, sorted
+    [n * 16 bytes]  : PackObjectLocation of every object, in the order of the ids
+*/
+
+constexpr const char* PACK_DIR = "pack";
+constexpr uint8_t PACK_FORMAT_VERSION = 1;
+
+constexpr std::array<char, 7> PACK_MAGIC = {'C', 'A', 'F', 'P', 'A', 'C', 'K'};
+constexpr std::array<char, 7> PACK_INDEX_MAGIC = {'C', 'A', 'F', 'P', 'I', 'D', 'X'};
+struct PackFileTag {
+    std::array<char, 7> magic;
+    uint8_t version;
+};
+
+struct PackIndexHeader {
+    uint64_t num_objects;
+    uint64_t id_size;
+};
+
+struct PackObjectLocation {
+    uint64_t offset;  // from the start of the pack file
+    uint64_t size;
+};
+
+constexpr size_t PACK_FANOUT_SIZE = 256;
+
+// A pack and its index mapped for reading, lookups are a binary search within the fanout range of the id's first byte.
+class PackFile {
+public:
+    // index_path is the .idx file, its pack is the .pack file next to it
+    static PackFile open(const std::string& index_path);
+
+    const std::string& path() const { return index_path; }
+    // a pack written with the same objects replaces the files at the same paths, the inode of the index tells them apart
+    ino_t index_inode() const { return index_ino; }
+    size_t size() const { return num_objects; }
+
+    std::optional<std::span<const std::byte>> find(const ObjectId& id) const;
+
+    // The i-th object in the order of the ids
+    ObjectId id(const size_t i) const;
+    std::span<const std::byte> object(const size_t i) const;
+
+private:
+    PackFile(std::string index_path, ino_t index_ino, MappedFile index, MappedFile pack);
+
+    std::string index_path;
+    ino_t index_ino;
+    MappedFile index;
+    MappedFile pack;
+    size_t num_objects;
+    size_t id_size;
+};
+
+// Writes the objects added to it into a new pack of content_root_dir, pack and index are only moved into place by
+// finish so an unfinished pack is never seen.
+class PackWriter {
+public:
+    explicit PackWriter(const std::string& content_root_dir);
+    PackWriter(PackWriter&& other) noexcept;
+    PackWriter(const PackWriter&) = delete;
+    PackWriter& operator=(const PackWriter&) = delete;
+    PackWriter& operator=(PackWriter&&) = delete;
+    ~PackWriter();
+
+    // Copies the rest of fd into the pack
+    void add(const ObjectId& id, const int fd);
+    void add(const ObjectId& id, std::span<const std::byte> data);
+
+    // Returns the path of the index of the new pack
+    std::string finish();
+
+private:
+    struct Entry {
+        ObjectId id;
+        PackObjectLocation location;
+    };
+
+    std::string pack_dir;
+    std::string temp_path;
+    int fd;
+    uint64_t offset;
+    std::vector<Entry> entries;
+
+    void check_id_size(const ObjectId& id) const;
+};
+
+// The index files in the pack directory of content_root_dir, none when it has no pack directory
+std::vector<std::string> list_pack_indexes(const std::string& content_root_dir);
+
+// The pack file next to an index file
+std::string pack_path_for_index(const std::string& index_path);
+
+#endif // PACK_H
@@ -0,0 +1,111 @@
+#include "snapshot.h"
+
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "caf.h"
+#include "hash_types.h"
+#include "object_io.h"
+#include "tree.h"
+#include "util/parallel.h"
+
+struct SnapshotDir {
+    std::filesystem::path path;
+    std::vector<std::string> file_names;
+    std::vector<std::filesystem::path> file_paths;
+    std::vector<std::string> subdir_names;
+    std::vector<size_t> subdirs; // indexes into the directories of the snapshot
+    size_t first_file = 0;       // index of the first file in the files of the snapshot
+    std::string tree_hash;
+};
+
+static void list_directory(SnapshotDir& dir, std::vector<std::filesystem::path>& subdir_paths,
+                    const std::unordered_set<std::string>& ignore) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir.path, ec);
+    if (ec)
+        throw std::runtime_error("Failed to list " + dir.path.string() + ": " + ec.message());
+
+    for (const std::filesystem::directory_entry& entry : it) {
+        std::string name = entry.path().filename().string();
+        if (ignore.contains(name))
+            continue;
+
+        if (entry.is_regular_file(ec)) {
+            dir.file_names.push_back(std::move(name));
+            dir.file_paths.push_back(entry.path());
+        } else if (entry.is_directory(ec)) {
+            dir.subdir_names.push_back(std::move(name));
+            subdir_paths.push_back(entry.path());
+        }
+    }
+}
+
+std::string snapshot_directory(const std::string& dir_path, const std::string& content_root_dir,
+                               const std::vector<std::string>& ignore, const bool compress,
+                               const HashAlgorithm algorithm) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir_path, ec))
+        throw std::invalid_argument(dir_path + " is not a directory");
+
+    const std::unordered_set<std::string> ignored(ignore.begin(), ignore.end());
+
+    // levels[d] holds the indexes of the directories at depth d
+    std::vector<SnapshotDir> dirs(1);
+    dirs[0].path = dir_path;
+    std::vector<std::vector<size_t>> levels = {{0}};
+
+    while (!levels.back().empty()) {
+        const std::vector<size_t>& level = levels.back();
+        std::vector<std::vector<std::filesystem::path>> subdir_paths(level.size());
+
+        parallel_for_each_index(level.size(), [&](const size_t i) {
+            list_directory(dirs[level[i]], subdir_paths[i], ignored);
+        });
+
+        std::vector<size_t> next_level;
+        for (size_t i = 0; i < level.size(); ++i) {
+            for (std::filesystem::path& path : subdir_paths[i]) {
+                dirs[level[i]].subdirs.push_back(dirs.size());
+                next_level.push_back(dirs.size());
+                dirs.emplace_back().path = std::move(path);
+            }
+        }
+        levels.push_back(std::move(next_level));
+    }
+    levels.pop_back();
+
+    std::vector<std::string> files;
+    for (SnapshotDir& dir : dirs) {
+        dir.first_file = files.size();
+        for (std::filesystem::path& path : dir.file_paths)
+            files.push_back(std::move(path).string());
+        dir.file_paths.clear();
+    }
+
+    const std::vector<SavedBlob> blobs = save_files_content(content_root_dir, files, compress, false, algorithm);
+
+    for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+        parallel_for_each_index(level->size(), [&](const size_t i) {
+            SnapshotDir& dir = dirs[(*level)[i]];
+
+            std::map<std::string, TreeRecord> records;
+            for (size_t f = 0; f < dir.file_names.size(); ++f) {
+                const std::string& name = dir.file_names[f];
+                records.emplace(name, TreeRecord(TreeRecord::Type::BLOB, ObjectId::parse_hex(blobs[dir.first_file + f].hash), name));
+            }
+            for (size_t s = 0; s < dir.subdirs.size(); ++s) {
+                const std::string& name = dir.subdir_names[s];
+                records.emplace(name, TreeRecord(TreeRecord::Type::TREE, ObjectId::parse_hex(dirs[dir.subdirs[s]].tree_hash), name));
+            }
+
+            const Tree tree(records);
+            save_tree(content_root_dir, tree, algorithm);
+            dir.tree_hash = hash_object(tree, algorithm);
+        });
+    }
+
+    return dirs[0].tree_hash;
+}
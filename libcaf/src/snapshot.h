@@ -0,0 +1,18 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include "hash_algorithm.h"
+
+// Saves the content of a directory into content_root_dir and returns the hash of its tree. Entries whose name is in
+// ignore are skipped at any depth, and entries that are neither files nor directories are skipped, symlinks count as
+// what they point to. The directories are listed one depth at a time and every file of the snapshot is stored in a
+// single parallel batch (see save_files_content), then the trees are built and saved from the deepest directories up,
+// each depth in parallel.
+std::string snapshot_directory(const std::string& dir_path, const std::string& content_root_dir,
+                               const std::vector<std::string>& ignore, const bool compress = false,
+                               const HashAlgorithm algorithm = HashAlgorithm::SHA1);
+
+#endif // SNAPSHOT_H
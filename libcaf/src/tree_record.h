@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "object_id.h"
+
 class TreeRecord {
 public:
     enum class Type {
@@ -12,10 +14,10 @@ public:
     };
     
     const Type type;
-    const std::string hash;
+    const ObjectId hash;
     const std::string name;
 
-    TreeRecord(Type type, std::string hash, std::string name)
+    TreeRecord(Type type, ObjectId hash, std::string name)
         : type(type), hash(hash), name(name) {}
 };
 
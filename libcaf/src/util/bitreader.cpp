@@ -53,4 +53,8 @@ void BitReader::advance(const size_t n_bits) {
 
 bool BitReader::done() const {
     return bit_pos >= data_size_in_bits;
-}
\ No newline at end of file
+}
+
+size_t BitReader::remaining() const {
+    return done() ? 0 : data_size_in_bits - bit_pos;
+}
@@ -11,6 +11,7 @@ public:
     uint64_t read(const size_t n_bits) const;
     void advance(const size_t n_bits);
     bool done() const;
+    size_t remaining() const;
 
 private:
     std::span<const std::byte> data;
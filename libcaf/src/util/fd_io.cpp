@@ -0,0 +1,110 @@
+#include "fd_io.h"
+
+#include <cerrno>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/sendfile.h>
+#endif
+
+constexpr size_t COPY_BUFFER_SIZE = 1 << 20;
+constexpr size_t COPY_CHUNK_SIZE = 1 << 30;
+
+size_t read_full(const int fd, const std::span<std::byte> buffer) {
+    size_t total = 0;
+    while (total < buffer.size()) {
+        const ssize_t n = read(fd, buffer.data() + total, buffer.size() - total);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Failed to read input");
+        }
+        if (n == 0)
+            break;
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+void write_full(const int fd, const std::span<const std::byte> buffer) {
+    size_t total = 0;
+    while (total < buffer.size()) {
+        const ssize_t n = write(fd, buffer.data() + total, buffer.size() - total);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Failed to write output");
+        }
+        total += static_cast<size_t>(n);
+    }
+}
+
+#ifdef __linux__
+// Errors that mean the method isn't available for this pair of files rather than that copying failed.
+static bool is_unsupported(const int error) {
+    return error == ENOSYS || error == EOPNOTSUPP || error == ENOTSUP || error == EXDEV || error == EINVAL ||
+           error == ENOTTY || error == EBADF;
+}
+
+static bool try_reflink(const int in_fd, const int out_fd) {
+#ifdef FICLONE
+    if (lseek(in_fd, 0, SEEK_CUR) != 0 || lseek(out_fd, 0, SEEK_CUR) != 0)
+        return false;
+
+    if (ioctl(out_fd, FICLONE, in_fd) == 0) {
+        // the clone doesn't move the offsets, leave them at the end like the other methods do
+        lseek(in_fd, 0, SEEK_END);
+        lseek(out_fd, 0, SEEK_END);
+        return true;
+    }
+
+    if (!is_unsupported(errno))
+        throw std::runtime_error("Failed to clone file");
+#endif
+    return false;
+}
+
+// Runs a kernel copy call until the end of the input. Returns false when the very first call reports the method as
+// unsupported, nothing has been copied then and the caller can fall back to the next method.
+template <typename CopyCall>
+static bool copy_with(CopyCall copy_call) {
+    bool copied_any = false;
+    while (true) {
+        const ssize_t n = copy_call();
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (!copied_any && is_unsupported(errno))
+                return false;
+            throw std::runtime_error("Failed to copy file");
+        }
+        if (n == 0)
+            return true;
+        copied_any = true;
+    }
+}
+#endif
+
+CopyMethod copy_fd(const int in_fd, const int out_fd) {
+#ifdef __linux__
+    if (try_reflink(in_fd, out_fd))
+        return CopyMethod::REFLINK;
+
+    if (copy_with([&] { return copy_file_range(in_fd, nullptr, out_fd, nullptr, COPY_CHUNK_SIZE, 0); }))
+        return CopyMethod::COPY_FILE_RANGE;
+
+    if (copy_with([&] { return sendfile(out_fd, in_fd, nullptr, COPY_CHUNK_SIZE); }))
+        return CopyMethod::SENDFILE;
+#endif
+
+    std::vector<std::byte> buffer(COPY_BUFFER_SIZE);
+    while (true) {
+        const size_t n = read_full(in_fd, buffer);
+        write_full(out_fd, std::span<const std::byte>(buffer.data(), n));
+        if (n < buffer.size())
+            return CopyMethod::BUFFERED;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef FD_IO_H
+#define FD_IO_H
+
+#include <cstddef>
+#include <span>
+
+// Reads until the buffer is full or the end of the input, retrying short reads and EINTR, so it works the same on
+// files, pipes and sockets. Returns the number of bytes read, less than buffer.size() only at the end of the input.
+size_t read_full(const int fd, const std::span<std::byte> buffer);
+
+// Writes the whole buffer, retrying short writes and EINTR.
+void write_full(const int fd, const std::span<const std::byte> buffer);
+
+// How copy_fd moved the data, from cheapest to most expensive.
+enum class CopyMethod {
+    REFLINK,          // FICLONE, the destination shares the source's extents (btrfs, XFS)
+    COPY_FILE_RANGE,  // copied inside the kernel, or by the filesystem itself (NFS, SMB)
+    SENDFILE,         // copied inside the kernel through the page cache
+    BUFFERED          // read and written through a user space buffer
+};
+
+// Copies from the current offset of in_fd to the end of the input into out_fd. Each method is tried in the order of
+// CopyMethod and the next one is used when the kernel or filesystem doesn't support it, e.g. across filesystems.
+// A reflink replaces the whole destination with the whole source, so it's only tried when both offsets are 0.
+CopyMethod copy_fd(const int in_fd, const int out_fd);
+
+#endif // FD_IO_H
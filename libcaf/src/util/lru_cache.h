@@ -0,0 +1,94 @@
+#ifndef LRU_CACHE_H
+#define LRU_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+struct LruCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    size_t size;
+    size_t capacity;
+};
+
+// A thread-safe cache of at most capacity values that evicts the least recently used one, a capacity of 0 disables it.
+template <typename Key, typename Value>
+class LruCache {
+public:
+    explicit LruCache(const size_t capacity) : capacity(capacity) {}
+
+    std::optional<Value> get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = index.find(key);
+        if (it == index.end()) {
+            ++misses;
+            return std::nullopt;
+        }
+
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void put(const Key& key, Value value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (capacity == 0)
+            return;
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = std::move(value);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        entries.emplace_front(key, std::move(value));
+        index.emplace(key, entries.begin());
+        evict();
+    }
+
+    void set_capacity(const size_t new_capacity) {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = new_capacity;
+        evict();
+    }
+
+    // Drops the values and zeroes the counters
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+        hits = 0;
+        misses = 0;
+    }
+
+    LruCacheStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return {hits, misses, entries.size(), capacity};
+    }
+
+private:
+    using Entry = std::pair<Key, Value>;
+
+    mutable std::mutex mutex;
+    size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    void evict() {
+        while (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+#endif // LRU_CACHE_H
@@ -0,0 +1,91 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const int file_fd, const struct stat& st, std::byte* ptr, const size_t size) :
+    file_fd(file_fd), st(st), ptr(ptr), map_size(size) {}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    file_fd(other.file_fd), st(other.st), ptr(other.ptr), map_size(other.map_size) {
+    other.file_fd = -1;
+    other.ptr = nullptr;
+    other.map_size = 0;
+}
+
+MappedFile::~MappedFile() {
+    if (ptr != nullptr)
+        munmap(ptr, map_size);
+    if (file_fd >= 0)
+        close(file_fd);
+}
+
+MappedFile MappedFile::open_for_reading(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open input file");
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to get file size");
+    }
+
+    const size_t size = file_stat.st_size;
+    if (size == 0)
+        return MappedFile(fd, file_stat, nullptr, 0);
+
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map file");
+    }
+
+    return MappedFile(fd, file_stat, static_cast<std::byte*>(ptr), size);
+}
+
+MappedFile MappedFile::create(const std::string& path, const size_t size) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open output file");
+
+    struct stat file_stat;
+    if (ftruncate(fd, size) < 0 || fstat(fd, &file_stat) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to truncate output file");
+    }
+
+    if (size == 0)
+        return MappedFile(fd, file_stat, nullptr, 0);
+
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map file");
+    }
+
+    return MappedFile(fd, file_stat, static_cast<std::byte*>(ptr), size);
+}
+
+std::span<const std::byte> MappedFile::data() const {
+    return {ptr, map_size};
+}
+
+std::span<std::byte> MappedFile::writable_data() {
+    return {ptr, map_size};
+}
+
+size_t MappedFile::size() const {
+    return map_size;
+}
+
+int MappedFile::fd() const {
+    return file_fd;
+}
+
+const struct stat& MappedFile::file_stat() const {
+    return st;
+}
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <sys/stat.h>
+
+// Memory mapping of a whole file, unmapped and closed when the object goes out of scope.
+// Empty files are not mapped at all and have an empty span.
+class MappedFile {
+public:
+    static MappedFile open_for_reading(const std::string& path);
+    static MappedFile create(const std::string& path, const size_t size); // creates or truncates the file to size
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    ~MappedFile();
+
+    std::span<const std::byte> data() const;
+    std::span<std::byte> writable_data();
+    size_t size() const;
+    int fd() const; // stays open as long as the mapping, its offset is left for the caller to use
+    const struct stat& file_stat() const; // as it was when the file was mapped
+
+private:
+    MappedFile(const int file_fd, const struct stat& st, std::byte* ptr, const size_t size);
+
+    int file_fd;
+    struct stat st;
+    std::byte* ptr;
+    size_t map_size;
+};
+
+#endif // MAPPED_FILE_H
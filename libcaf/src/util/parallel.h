@@ -0,0 +1,28 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <exception>
+
+// Runs func for every index on the OpenMP threads. The items vary in cost so they're handed out one at a time, and
+// the first exception thrown by any of them is rethrown once the loop is done.
+template <typename Func>
+void parallel_for_each_index(const size_t count, Func func) {
+    std::exception_ptr error;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < count; ++i) {
+        try {
+            func(i);
+        } catch (...) {
+            #pragma omp critical
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+#endif // PARALLEL_H
@@ -1,7 +1,9 @@
 from pathlib import Path
 
 from libcaf.constants import DEFAULT_BRANCH, DEFAULT_REPO_DIR, HEADS_DIR, HEAD_FILE, REFS_DIR
+from libcaf import HashAlgorithm
 from libcaf.ref import SymRef, read_ref
+from libcaf.repository import Repository
 from pytest import mark
 
 from caf import cli_commands
@@ -34,3 +36,21 @@ def test_init_repository_str_repo_dir(temp_repo_dir: Path) -> None:
 
     repo_path = temp_repo_dir / '.testcaf'
     assert repo_path.exists()
+
+
+def test_init_repository_compressed(temp_repo_dir: Path) -> None:
+    assert cli_commands.init(working_dir_path=temp_repo_dir, compress=True) == 0
+
+    assert Repository(temp_repo_dir).compress_objects()
+
+
+def test_init_repository_hash_algorithm(temp_repo_dir: Path) -> None:
+    assert cli_commands.init(working_dir_path=temp_repo_dir, hash_algorithm='blake3') == 0
+
+    assert Repository(temp_repo_dir).hash_algorithm() == HashAlgorithm.BLAKE3
+
+
+def test_init_repository_unknown_hash_algorithm(temp_repo_dir: Path) -> None:
+    assert cli_commands.init(working_dir_path=temp_repo_dir, hash_algorithm='md5') == -1
+
+    assert not (temp_repo_dir / DEFAULT_REPO_DIR).exists()
@@ -0,0 +1,23 @@
+from pathlib import Path
+
+from libcaf.repository import Repository
+from pytest import CaptureFixture
+
+from caf import cli_commands
+
+
+def test_repack_command(temp_repo: Repository, capsys: CaptureFixture[str]) -> None:
+    temp_file = temp_repo.working_dir / 'repack_test.txt'
+    temp_file.write_text('Repack content')
+    temp_repo.commit_working_dir('Repack Tester', 'Commit to pack')
+
+    assert cli_commands.repack(working_dir_path=temp_repo.working_dir) == 0
+    assert 'Packed 3 objects' in capsys.readouterr().out
+
+    assert cli_commands.log(working_dir_path=temp_repo.working_dir) == 0
+    assert 'Commit to pack' in capsys.readouterr().out
+
+
+def test_repack_no_repo(temp_repo_dir: Path, capsys: CaptureFixture[str]) -> None:
+    assert cli_commands.repack(working_dir_path=temp_repo_dir) == -1
+    assert 'No repository found' in capsys.readouterr().err
@@ -36,6 +36,7 @@ def pytest_sessionfinish(session, exitstatus):
     encode_sequential_times = {}
     encode_parallel_times = {}
     encode_twopass_times = {}
+    encode_64bit_times = {}
 
     for bench in benchmarks_data:
         name = bench["name"]
@@ -68,6 +69,8 @@ def pytest_sessionfinish(session, exitstatus):
             param = bench["params"]["payload_size"]
             if "parallel_twopass" in name:
                 encode_twopass_times[param] = bench["stats"].mean
+            elif "64bit" in name:
+                encode_64bit_times[param] = bench["stats"].mean
             elif "parallel" in name:
                 encode_parallel_times[param] = bench["stats"].mean
             elif "sequential" in name:
@@ -122,13 +125,14 @@ def pytest_sessionfinish(session, exitstatus):
         print(f"Benchmark plot saved to {plot_path}")
 
     if encode_sequential_times:
-        _generate_encode_span_report(encode_sequential_times, encode_parallel_times, encode_twopass_times)
+        _generate_encode_span_report(encode_sequential_times, encode_parallel_times, encode_twopass_times,
+                                     encode_64bit_times)
 
     if compression_data:
         _generate_compression_ratio_report(compression_data)
 
 
-def _generate_encode_span_report(sequential_times, parallel_times, twopass_times):
+def _generate_encode_span_report(sequential_times, parallel_times, twopass_times, word_times):
     """Generate plot for huffman_encode_span benchmark comparing implementations."""
 
     sizes = sorted(sequential_times.keys())
@@ -136,6 +140,7 @@ def _generate_encode_span_report(sequential_times, parallel_times, twopass_times
     # Calculate speedup ratios vs sequential baseline
     speedups_parallel = [sequential_times[s] / parallel_times[s] if s in parallel_times else 1.0 for s in sizes]
     speedups_twopass = [sequential_times[s] / twopass_times[s] if s in twopass_times else 1.0 for s in sizes]
+    speedups_word = [sequential_times[s] / word_times[s] if s in word_times else 1.0 for s in sizes]
 
     fig, (ax1, ax2) = plt.subplots(2, 1, figsize=(10, 8), height_ratios=[2, 1])
 
@@ -145,6 +150,8 @@ def _generate_encode_span_report(sequential_times, parallel_times, twopass_times
         ax1.loglog(sizes, [parallel_times.get(s, float('nan')) for s in sizes], marker='^', linestyle='--', label='parallel')
     if twopass_times:
         ax1.loglog(sizes, [twopass_times.get(s, float('nan')) for s in sizes], marker='s', linestyle='-', label='parallel_twopass')
+    if word_times:
+        ax1.loglog(sizes, [word_times.get(s, float('nan')) for s in sizes], marker='d', linestyle='-', label='64bit')
     ax1.set_xlabel('Payload Size')
     ax1.set_ylabel('Time (seconds)')
     ax1.set_title('Huffman Encode Span Benchmark')
@@ -158,6 +165,8 @@ def _generate_encode_span_report(sequential_times, parallel_times, twopass_times
         ax2.semilogx(sizes, speedups_parallel, marker='^', linestyle='--', color='orange', linewidth=2, label='parallel')
     if twopass_times:
         ax2.semilogx(sizes, speedups_twopass, marker='s', linestyle='-', color='green', linewidth=2, label='parallel_twopass')
+    if word_times:
+        ax2.semilogx(sizes, speedups_word, marker='d', linestyle='-', color='purple', linewidth=2, label='64bit')
     ax2.axhline(y=1.0, color='gray', linestyle='--', alpha=0.7, label='No speedup')
     ax2.set_xlabel('Payload Size')
     ax2.set_ylabel('Speedup (x)')
@@ -166,7 +175,8 @@ def _generate_encode_span_report(sequential_times, parallel_times, twopass_times
     ax2.legend()
     ax2.xaxis.set_major_formatter(FuncFormatter(lambda x, pos: humanize.naturalsize(x)))
     ax2.set_xlim(min(sizes), max(sizes))
-    all_speedups = (speedups_parallel if parallel_times else []) + (speedups_twopass if twopass_times else [])
+    all_speedups = (speedups_parallel if parallel_times else []) + (speedups_twopass if twopass_times else []) + \
+                   (speedups_word if word_times else [])
     if all_speedups:
         ax2.set_ylim(0, max(max(all_speedups) * 1.1, 2.0))
 
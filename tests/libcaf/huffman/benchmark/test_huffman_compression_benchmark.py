@@ -9,6 +9,7 @@ from libcaf import (
     huffman_encode_span,
     huffman_encode_span_parallel,
     huffman_encode_span_parallel_twopass,
+    huffman_encode_span_64bit,
 )
 
 SIZES = [
@@ -36,7 +37,8 @@ SIZES = [
     huffman_encode_span,
     huffman_encode_span_parallel,
     huffman_encode_span_parallel_twopass,
-], ids=['sequential', 'parallel', 'parallel_twopass'])
+    huffman_encode_span_64bit,
+], ids=['sequential', 'parallel', 'parallel_twopass', '64bit'])
 @mark.parametrize('payload_size', SIZES)
 def test_benchmark_huffman_encode_span(random_payload: np.ndarray, benchmark, encode_func) -> None:  # type: ignore[no-untyped-def]
     """Benchmark different huffman_encode_span implementations."""
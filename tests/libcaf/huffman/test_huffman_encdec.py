@@ -3,10 +3,14 @@ from pytest import mark
 
 from libcaf import (
     huffman_encode_span,
+    huffman_encode_span_64bit,
     huffman_decode_span,
+    huffman_decode_span_multisymbol,
     histogram_parallel,
     huffman_tree,
     huffman_dict,
+    huffman_code_lengths,
+    reconstruct_canonical_dict,
     huffman_build_reverse_dict,
     canonicalize_huffman_dict,
     calculate_compressed_size_in_bits,
@@ -90,4 +94,62 @@ def test_huffman_encdec(random_payload: np.ndarray) -> None:
     decoded_data = np.zeros(len(random_payload), dtype=np.uint8)
     huffman_decode_span(encoded_data, total_bits, decoded_data, dictionary)
     
-    np.testing.assert_array_equal(random_payload, decoded_data)
\ No newline at end of file
+    np.testing.assert_array_equal(random_payload, decoded_data)
+
+
+@mark.parametrize('payload_size', [
+    0,
+    1,
+    7,
+    9,
+    100,
+    2 ** 12,
+    2 ** 16,
+    2 ** 20,  # 1 MiB
+])
+def test_huffman_encode_span_64bit(random_payload: np.ndarray) -> None:
+    """The 64-bit kernel must produce exactly the same bitstream as huffman_encode_span."""
+
+    hist = histogram_parallel(random_payload)
+    tree = huffman_tree(hist)
+    dictionary = huffman_dict(tree)
+    canonicalize_huffman_dict(dictionary)
+
+    total_bytes = (calculate_compressed_size_in_bits(hist, dictionary) + 7) // 8
+
+    expected = np.zeros(total_bytes, dtype=np.uint8)
+    huffman_encode_span(random_payload, expected, dictionary)
+
+    # the destination is overwritten, it does not need to be zeroed
+    actual = np.full(total_bytes, 0xAA, dtype=np.uint8)
+    huffman_encode_span_64bit(random_payload, actual, dictionary)
+
+    np.testing.assert_array_equal(expected, actual)
+
+
+@mark.parametrize('payload_size', [
+    0,
+    1,
+    15,
+    17,
+    100,
+    2 ** 12,
+    2 ** 16,
+    2 ** 20,  # 1 MiB
+    2 ** 24,  # 16 MiB
+])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+def test_huffman_decode_span_multisymbol(payload: np.ndarray) -> None:
+    """The multi-symbol decoder must restore exactly what huffman_encode_span_64bit wrote."""
+
+    hist = histogram_parallel(payload)
+    dictionary = reconstruct_canonical_dict(huffman_code_lengths(hist))
+
+    total_bits = calculate_compressed_size_in_bits(hist, dictionary)
+    encoded_data = np.zeros((total_bits + 7) // 8, dtype=np.uint8)
+    huffman_encode_span_64bit(payload, encoded_data, dictionary)
+
+    decoded_data = np.zeros(len(payload), dtype=np.uint8)
+    huffman_decode_span_multisymbol(encoded_data, total_bits, decoded_data, dictionary)
+
+    np.testing.assert_array_equal(payload, decoded_data)
@@ -2,9 +2,13 @@ import numpy as np
 import os
 import tempfile
 from pathlib import Path
-from pytest import mark
+from pytest import mark, raises
 
-from libcaf import huffman_encode_file, huffman_decode_file, HUFFMAN_HEADER_SIZE
+from libcaf import (huffman_encode_file, huffman_encode_file_indexed, huffman_encode_file_multistream,
+                    huffman_encode_stream, huffman_decode_stream, huffman_encode_file_adaptive,
+                    huffman_encode_file_compact, huffman_decode_file,
+                    HUFFMAN_HEADER_SIZE, HUFFMAN_STORED_HEADER_SIZE, HUFFMAN_DEFAULT_INDEX_INTERVAL,
+                    HUFFMAN_DEFAULT_BLOCK_SIZE)
 
 
 @mark.parametrize('payload_size', [
@@ -167,4 +171,269 @@ def test_huffman_file_encoding_decoding(random_payload: np.ndarray) -> None:
         assert restored_file.stat().st_size == input_file.stat().st_size
 
         restored_data = np.fromfile(restored_file, dtype=np.uint8)
-        np.testing.assert_array_equal(random_payload, restored_data)
\ No newline at end of file
+        np.testing.assert_array_equal(random_payload, restored_data)
+
+
+@mark.parametrize('max_code_len', [9, 11, 12])
+def test_huffman_file_encoding_decoding_skewed(max_code_len: int) -> None:
+    """Test that a distribution whose huffman tree is deeper than the decode table still round trips."""
+
+    rng = np.random.default_rng(0xFEED)
+    counts = [1, 1]
+    while len(counts) < 30:
+        counts.append(counts[-1] + counts[-2])
+    skewed_payload = np.repeat(np.arange(len(counts), dtype=np.uint8), counts)
+    rng.shuffle(skewed_payload)
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "skewed.bin"
+        compressed_file = Path(tmpdir) / "skewed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        skewed_payload.tofile(input_file)
+
+        huffman_encode_file(str(input_file), str(compressed_file), max_code_len)
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(skewed_payload, restored_data)
+
+
+@mark.parametrize('payload_size', [0, 1, 1000, 2 ** 16 + 3, 2 ** 22])
+@mark.parametrize('index_interval', [7, 4096, HUFFMAN_DEFAULT_INDEX_INTERVAL])
+def test_huffman_file_encoding_decoding_indexed(random_payload: np.ndarray, index_interval: int) -> None:
+    """Test that an indexed file decodes back to the original, including a partial last segment."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        random_payload.tofile(input_file)
+
+        compressed_size = huffman_encode_file_indexed(str(input_file), str(compressed_file), index_interval)
+        assert compressed_file.stat().st_size == compressed_size
+
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(random_payload, restored_data)
+
+
+@mark.parametrize('payload_size', [0, 3, 1000, 2 ** 16 + 5, 2 ** 22])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+@mark.parametrize('num_streams', [4, 8])
+def test_huffman_file_encoding_decoding_multistream(payload: np.ndarray, num_streams: int) -> None:
+    """Test that a multi-stream file decodes back to the original, including inputs shorter than the stream count."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+
+        compressed_size = huffman_encode_file_multistream(str(input_file), str(compressed_file), num_streams)
+        assert compressed_file.stat().st_size == compressed_size
+
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(payload, restored_data)
+
+
+def test_huffman_decode_file_over_subscribed_code_lengths() -> None:
+    """Test that header code lengths with more codes than fit, e.g. every symbol 1 bit long, are rejected."""
+
+    payload = np.random.default_rng(0xC0DE).integers(0, 16, 2 ** 12, dtype=np.uint8)
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+        huffman_encode_file(str(input_file), str(compressed_file))
+
+        # the code lengths follow the tag and the two sizes of the header
+        lengths_offset = 8 + 16
+        data = bytearray(compressed_file.read_bytes())
+        data[lengths_offset:lengths_offset + 512] = (1).to_bytes(2, 'little') * 256
+        compressed_file.write_bytes(bytes(data))
+
+        with raises(RuntimeError):
+            huffman_decode_file(str(compressed_file), str(restored_file))
+
+
+def test_huffman_decode_file_multistream_overflowing_stream_sizes() -> None:
+    """Test that stream sizes whose byte counts wrap around when rounded up are rejected instead of read past."""
+
+    payload = np.random.default_rng(0x5EED).integers(0, 16, 2 ** 16, dtype=np.uint8)
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+        huffman_encode_file_multistream(str(input_file), str(compressed_file), 4)
+
+        # the stream sizes follow the tag, the header and the stream count
+        sizes_offset = 8 + HUFFMAN_HEADER_SIZE + 8
+        data = bytearray(compressed_file.read_bytes())
+        data[sizes_offset:sizes_offset + 8] = (2 ** 64 - 1).to_bytes(8, 'little')
+        compressed_file.write_bytes(bytes(data))
+
+        with raises(RuntimeError):
+            huffman_decode_file(str(compressed_file), str(restored_file))
+
+
+@mark.parametrize('payload_size', [0, 1, 4096, 4097, 2 ** 20 + 1])
+@mark.parametrize('block_size', [4096, HUFFMAN_DEFAULT_BLOCK_SIZE])
+def test_huffman_stream_encoding_decoding(random_payload: np.ndarray, block_size: int) -> None:
+    """Test that a file compressed block by block from a descriptor decodes back with huffman_decode_file."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        random_payload.tofile(input_file)
+
+        with open(input_file, 'rb') as src, open(compressed_file, 'wb') as dst:
+            compressed_size = huffman_encode_stream(src.fileno(), dst.fileno(), block_size)
+        assert compressed_file.stat().st_size == compressed_size
+
+        assert huffman_decode_file(str(compressed_file), str(restored_file)) == len(random_payload)
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(random_payload, restored_data)
+
+
+def test_huffman_stream_from_pipe() -> None:
+    """Test that the streaming coder works on a pipe, which can't be memory mapped."""
+
+    data = bytes(range(256)) * 16
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        read_fd, write_fd = os.pipe()
+        os.write(write_fd, data)
+        os.close(write_fd)
+
+        with open(compressed_file, 'wb') as dst:
+            huffman_encode_stream(read_fd, dst.fileno(), 1024)
+        os.close(read_fd)
+
+        with open(compressed_file, 'rb') as src, open(restored_file, 'wb') as dst:
+            assert huffman_decode_stream(src.fileno(), dst.fileno()) == len(data)
+
+        assert restored_file.read_bytes() == data
+
+
+@mark.parametrize('payload_size', [0, 1, 4096, 4097, 2 ** 20 + 1])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+def test_huffman_file_encoding_decoding_adaptive(payload: np.ndarray) -> None:
+    """Test that a file with per-block code tables decodes back to the original."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+
+        compressed_size = huffman_encode_file_adaptive(str(input_file), str(compressed_file), 4096)
+        assert compressed_file.stat().st_size == compressed_size
+
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(payload, restored_data)
+
+
+def test_huffman_encode_file_adaptive_mixed_content() -> None:
+    """Test that per-block tables beat a single table on a file made of very different regions."""
+
+    rng = np.random.default_rng(0xADA)
+    text = rng.integers(ord('a'), ord('z') + 1, 2 ** 18, dtype=np.uint8)
+    sparse = np.where(rng.random(2 ** 18) < 0.75, 0, rng.integers(0, 256, 2 ** 18)).astype(np.uint8)
+    narrow = rng.integers(128, 136, 2 ** 18, dtype=np.uint8)
+    mixed_payload = np.concatenate([text, sparse, narrow])
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "mixed.bin"
+        single_table_file = Path(tmpdir) / "single.huff"
+        adaptive_file = Path(tmpdir) / "adaptive.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        mixed_payload.tofile(input_file)
+
+        single_table_size = huffman_encode_file(str(input_file), str(single_table_file))
+        adaptive_size = huffman_encode_file_adaptive(str(input_file), str(adaptive_file), 2 ** 16)
+        assert adaptive_size < single_table_size
+
+        huffman_decode_file(str(adaptive_file), str(restored_file))
+        np.testing.assert_array_equal(mixed_payload, np.fromfile(restored_file, dtype=np.uint8))
+
+
+@mark.parametrize('max_code_len', [0, 4, 13])
+def test_huffman_encode_file_adaptive_invalid_max_code_len(max_code_len: int) -> None:
+    """Test that a max_code_len that is out of range, or too short for the symbols of a block, raises."""
+
+    payload = np.random.default_rng(0xC0DE).integers(0, 256, 2 ** 16, dtype=np.uint8)
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        payload.tofile(input_file)
+
+        with raises(ValueError):
+            huffman_encode_file_adaptive(str(input_file), str(compressed_file), 4096, max_code_len)
+
+
+@mark.parametrize('payload_size', [0, 10, 4096, 2 ** 20])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+def test_huffman_encode_file_store_incompressible(payload: np.ndarray) -> None:
+    """Test that data which would not shrink is stored as is, and that both kinds of file decode back."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+
+        compressed_size = huffman_encode_file(str(input_file), str(compressed_file), store_incompressible=True)
+        assert compressed_file.stat().st_size == compressed_size
+        assert compressed_size <= HUFFMAN_STORED_HEADER_SIZE + len(payload)
+
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(payload, restored_data)
+
+
+@mark.parametrize('payload_size', [0, 1, 100, 4096, 2 ** 20])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+def test_huffman_file_encoding_decoding_compact(payload: np.ndarray) -> None:
+    """Test that the compact header round trips and is smaller than the fixed one."""
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        input_file = Path(tmpdir) / "original.bin"
+        compressed_file = Path(tmpdir) / "compressed.huff"
+        legacy_file = Path(tmpdir) / "legacy.huff"
+        restored_file = Path(tmpdir) / "restored.bin"
+
+        payload.tofile(input_file)
+
+        compressed_size = huffman_encode_file_compact(str(input_file), str(compressed_file))
+        assert compressed_file.stat().st_size == compressed_size
+        assert compressed_size < huffman_encode_file(str(input_file), str(legacy_file))
+
+        huffman_decode_file(str(compressed_file), str(restored_file))
+
+        restored_data = np.fromfile(restored_file, dtype=np.uint8)
+        np.testing.assert_array_equal(payload, restored_data)
@@ -1,7 +1,8 @@
 import numpy as np
 from pytest import mark
 
-from libcaf import histogram, histogram_fast, histogram_parallel, histogram_parallel_64bit, huffman_tree
+from libcaf import (MAX_CODE_LEN, histogram, histogram_fast, histogram_parallel, histogram_parallel_64bit,
+                    histogram_subtables, huffman_code_lengths, huffman_tree)
 
 
 @mark.parametrize('payload_size', [
@@ -63,3 +64,59 @@ def test_huffman_invariants(random_payload: np.ndarray, histogram_func) -> None:
 
     for byte_val, expected in enumerate(hist):
         assert leaf_freqs[byte_val] == expected
+
+
+def _fibonacci_histogram(num_symbols: int) -> list[int]:
+    # Fibonacci frequencies produce the deepest possible huffman tree (90 symbols still fit in a uint64)
+    hist = [0] * 256
+    a, b = 1, 1
+    for symbol in range(num_symbols):
+        hist[symbol] = a
+        a, b = b, a + b
+    return hist
+
+
+@mark.parametrize('max_code_len', [9, 11, MAX_CODE_LEN])
+@mark.parametrize('num_symbols', [1, 2, 40, 90])
+def test_huffman_code_lengths_limited(num_symbols: int, max_code_len: int) -> None:
+    hist = _fibonacci_histogram(num_symbols)
+
+    code_lengths = huffman_code_lengths(hist, max_code_len)
+
+    for symbol in range(256):
+        assert (code_lengths[symbol] > 0) == (hist[symbol] > 0)
+        assert code_lengths[symbol] <= max_code_len
+
+    # The code is complete: the Kraft sum of a prefix code with at least 2 symbols is exactly 1
+    if num_symbols > 1:
+        assert sum(2 ** (max_code_len - length) for length in code_lengths if length) == 2 ** max_code_len
+
+
+@mark.parametrize('payload_size', [2 ** 12, 2 ** 16])
+def test_huffman_code_lengths_optimal(random_payload: np.ndarray) -> None:
+    # When the huffman tree already fits, the length limit must not cost any compression
+    hist = histogram(random_payload)
+    code_lengths = huffman_code_lengths(hist)
+
+    nodes = huffman_tree(hist)
+    depths = {len(nodes) - 1: 0}
+    huffman_cost = 0
+    for idx in reversed(range(len(nodes))):
+        node = nodes[idx]
+        if node.is_leaf:
+            huffman_cost += node.frequency * depths[idx]
+        else:
+            depths[node.left_index] = depths[idx] + 1
+            depths[node.right_index] = depths[idx] + 1
+
+    assert sum(h * length for h, length in zip(hist, code_lengths)) == huffman_cost
+
+
+@mark.parametrize('payload_size', [0, 1, 31, 33, 65, 2 ** 12 + 7, 2 ** 20])
+@mark.parametrize('payload_type', ['random', 'repetitive', 'uniform'])
+def test_histogram_subtables(payload: np.ndarray) -> None:
+    # Spreading the bytes over sub-tables must count exactly like the plain histogram
+    expected = histogram(payload)
+
+    assert histogram_subtables(payload) == expected
+    assert histogram_fast(payload) == expected
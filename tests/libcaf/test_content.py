@@ -1,8 +1,10 @@
 import hashlib
+from collections.abc import Callable
 from pathlib import Path
 
-from libcaf.plumbing import (delete_content, hash_file, open_content_for_reading, open_content_for_writing,
-                             save_file_content)
+from libcaf import HUFFMAN_STORED_HEADER_SIZE, CopyMethod
+from libcaf.plumbing import (copy_file, delete_content, hash_file, hash_files, ingest_file, open_content_for_reading,
+                             open_content_for_writing, repack_content, save_file_content, save_files_content)
 from pytest import mark, raises
 
 
@@ -28,6 +30,24 @@ class TestContent:
 
         assert actual == expected
 
+    def test_ingest_file(self, temp_content: tuple[Path, str]) -> None:
+        file, content = temp_content
+
+        ingested = ingest_file(file)
+
+        assert ingested.hash == hashlib.sha1(content).hexdigest()
+        assert list(ingested.histogram) == [content.count(byte) for byte in range(256)]
+
+    def test_copy_file(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
+        file, expected_content = temp_content
+
+        dest = temp_repo_dir / 'copy'
+        dest.write_bytes(b'stale content that is longer than nothing' * 10)
+
+        method = copy_file(file, dest)
+        assert method in CopyMethod.__members__.values()
+        assert dest.read_bytes() == expected_content
+
     def test_save_file_content(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
         file, expected_content = temp_content
 
@@ -37,7 +57,39 @@ class TestContent:
         assert saved_file.exists()
 
         saved_content = saved_file.read_bytes()
-        assert saved_content == expected_content
+        assert saved_content[:7] == b'CAFHUFF'
+        assert saved_content[HUFFMAN_STORED_HEADER_SIZE:] == expected_content
+
+    def test_save_file_content_twice(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
+        file, expected_content = temp_content
+
+        first_blob = save_file_content(temp_repo_dir, file)
+        second_blob = save_file_content(temp_repo_dir, file)
+        assert first_blob.hash == second_blob.hash
+        assert first_blob.created
+        assert not second_blob.created
+
+        saved_file = temp_repo_dir / first_blob.hash[:2] / first_blob.hash
+        assert saved_file.read_bytes()[HUFFMAN_STORED_HEADER_SIZE:] == expected_content
+        assert list(temp_repo_dir.glob('.ingest-*')) == []
+
+    @mark.parametrize('compress', [False, True])
+    def test_save_file_content_verify_replaces_damaged(self, temp_repo_dir: Path, temp_content: tuple[Path, str],
+                                                       compress: bool) -> None:
+        file, expected_content = temp_content
+
+        blob = save_file_content(temp_repo_dir, file, compress=compress)
+        assert not save_file_content(temp_repo_dir, file, compress=compress, verify=True).created
+
+        saved_file = temp_repo_dir / blob.hash[:2] / blob.hash
+        damaged = bytearray(saved_file.read_bytes())
+        damaged[-1] ^= 0xFF
+        saved_file.write_bytes(damaged)
+
+        assert save_file_content(temp_repo_dir, file, compress=compress, verify=True).created
+
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            assert f.read() == expected_content
 
     def test_open_content_for_reading(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
         file, expected_content = temp_content
@@ -49,19 +101,62 @@ class TestContent:
 
         assert saved_content == expected_content
 
-    def test_open_content_for_writing(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
+    def test_open_content_for_reading_shared(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
         file, expected_content = temp_content
 
         blob = save_file_content(temp_repo_dir, file)
 
-        with open_content_for_writing(temp_repo_dir, blob.hash) as f:
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f1, \
+                open_content_for_reading(temp_repo_dir, blob.hash) as f2:
+            assert f1.read() == expected_content
+            assert f2.read() == expected_content
+
+    def test_compressed_content_round_trip(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
+        file, expected_content = temp_content
+
+        blob = save_file_content(temp_repo_dir, file, compress=True)
+        assert blob.hash == hash_file(file)
+
+        saved_file = temp_repo_dir / blob.hash[:2] / blob.hash
+        assert saved_file.read_bytes()[:7] == b'CAFHUFF'
+
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            saved_content = f.read()
+
+        assert saved_content == expected_content
+        assert list(temp_repo_dir.glob('.decompress-*')) == []
+
+    def test_mixed_content_codecs(self, temp_repo_dir: Path,
+                                  temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        raw_file, raw_content = temp_content_file_factory()
+        compressed_file, compressed_content = temp_content_file_factory()
+
+        raw_blob = save_file_content(temp_repo_dir, raw_file)
+        compressed_blob = save_file_content(temp_repo_dir, compressed_file, compress=True)
+        assert not save_file_content(temp_repo_dir, raw_file, compress=True).created
+        assert not save_file_content(temp_repo_dir, compressed_file).created
+
+        for blob, content in [(raw_blob, raw_content), (compressed_blob, compressed_content)]:
+            with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+                assert f.read() == content
+
+    def test_open_content_for_writing(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
+        file, expected_content = temp_content
+
+        content_hash = hash_file(file)
+
+        with open_content_for_writing(temp_repo_dir, content_hash) as f:
             f.write(expected_content)
 
-        saved_file = temp_repo_dir / f'{blob.hash[:2]}/{blob.hash}'
+        saved_file = temp_repo_dir / f'{content_hash[:2]}/{content_hash}'
         saved_content = saved_file.read_bytes()
 
         assert saved_content == expected_content
 
+        # content written without a codec tag is read back as it is
+        with open_content_for_reading(temp_repo_dir, content_hash) as f:
+            assert f.read() == expected_content
+
     def test_save_and_delete_content(self, temp_repo_dir: Path, temp_content: tuple[Path, str]) -> None:
         file, _ = temp_content
 
@@ -72,3 +167,135 @@ class TestContent:
 
         delete_content(temp_repo_dir, blob.hash)
         assert not saved_file_path.exists()
+
+
+class TestBatchContent:
+    def test_hash_files(self, temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        files = [temp_content_file_factory(length=length) for length in [0, 1, 100, 10000, 1000000]]
+
+        hashes = hash_files([file for file, _ in files])
+
+        assert hashes == [hashlib.sha1(content).hexdigest() for _, content in files]
+
+    def test_hash_files_missing_file(self, temp_repo_dir: Path, temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        file, _ = temp_content_file_factory(length=100)
+
+        with raises(RuntimeError):
+            hash_files([file, temp_repo_dir / 'missing'])
+
+    def test_save_files_content(self, temp_repo_dir: Path, temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        files = [temp_content_file_factory(length=length) for length in [0, 1, 100, 10000, 1000000]]
+
+        blobs = save_files_content(temp_repo_dir, [file for file, _ in files])
+
+        for blob, (_, content) in zip(blobs, files, strict=True):
+            assert blob.created
+            assert blob.hash == hashlib.sha1(content).hexdigest()
+            assert (temp_repo_dir / blob.hash[:2] / blob.hash).read_bytes()[HUFFMAN_STORED_HEADER_SIZE:] == content
+
+        assert not any(blob.created for blob in save_files_content(temp_repo_dir, [file for file, _ in files]))
+
+
+class TestPackedContent:
+    @mark.parametrize('compress', [False, True])
+    def test_repack_content(self, temp_repo_dir: Path, temp_content_file_factory: Callable[..., tuple[Path, bytes]],
+                            compress: bool) -> None:
+        files = [temp_content_file_factory(length=length) for length in [0, 1, 100, 10000]]
+        blobs = save_files_content(temp_repo_dir, [file for file, _ in files], compress)
+
+        assert repack_content(temp_repo_dir) == len(files)
+        assert [path.name for path in temp_repo_dir.iterdir()] == ['pack']
+
+        for blob, (file, content) in zip(blobs, files, strict=True):
+            with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+                assert f.read() == content
+            assert not save_file_content(temp_repo_dir, file, compress).created
+
+    def test_repack_content_merges_packs(self, temp_repo_dir: Path,
+                                         temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        first_file, first_content = temp_content_file_factory()
+        first_blob = save_file_content(temp_repo_dir, first_file)
+        assert repack_content(temp_repo_dir) == 1
+
+        second_file, second_content = temp_content_file_factory()
+        second_blob = save_file_content(temp_repo_dir, second_file)
+        assert second_blob.created
+        assert repack_content(temp_repo_dir) == 2
+
+        assert len(list((temp_repo_dir / 'pack').glob('*.idx'))) == 1
+        for blob, content in [(first_blob, first_content), (second_blob, second_content)]:
+            with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+                assert f.read() == content
+
+    def test_verify_replaces_damaged_packed_content(self, temp_repo_dir: Path,
+                                                    temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        file, content = temp_content_file_factory(b'Hello packed world')
+        blob = save_file_content(temp_repo_dir, file)
+        repack_content(temp_repo_dir)
+
+        pack = next((temp_repo_dir / 'pack').glob('*.pack'))
+        pack_data = pack.read_bytes()
+        pack.write_bytes(pack_data.replace(content, b'J' + content[1:]))
+
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            assert f.read() == b'Jello packed world'
+        assert not save_file_content(temp_repo_dir, file).created
+
+        assert save_file_content(temp_repo_dir, file, verify=True).created
+        assert not pack.exists()
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            assert f.read() == content
+        assert not save_file_content(temp_repo_dir, file, verify=True).created
+
+        repack_content(temp_repo_dir)
+        assert [path.name for path in temp_repo_dir.iterdir()] == ['pack']
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            assert f.read() == content
+
+    def test_verify_rewrites_pack_of_damaged_content(self, temp_repo_dir: Path,
+                                                      temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        file, content = temp_content_file_factory(b'Hello packed world')
+        other_file, other_content = temp_content_file_factory()
+        blob = save_file_content(temp_repo_dir, file)
+        other_blob = save_file_content(temp_repo_dir, other_file)
+        repack_content(temp_repo_dir)
+
+        pack = next((temp_repo_dir / 'pack').glob('*.pack'))
+        pack.write_bytes(pack.read_bytes().replace(content, b'J' + content[1:]))
+
+        assert save_file_content(temp_repo_dir, file, verify=True).created
+
+        # the other object moved to a pack of its own
+        assert not pack.exists()
+        assert len(list((temp_repo_dir / 'pack').glob('*.idx'))) == 1
+        for saved, expected in [(blob, content), (other_blob, other_content)]:
+            with open_content_for_reading(temp_repo_dir, saved.hash) as f:
+                assert f.read() == expected
+
+    def test_delete_packed_content(self, temp_repo_dir: Path,
+                                   temp_content_file_factory: Callable[..., tuple[Path, bytes]]) -> None:
+        file, content = temp_content_file_factory()
+        blob = save_file_content(temp_repo_dir, file)
+        repack_content(temp_repo_dir)
+
+        delete_content(temp_repo_dir, blob.hash)
+
+        assert [path.name for path in temp_repo_dir.iterdir()] == ['pack']
+        with open_content_for_reading(temp_repo_dir, blob.hash) as f:
+            assert f.read() == content
+
+    def test_repack_skips_content_being_written(self, temp_repo_dir: Path) -> None:
+        content = b'Hello written world'
+        content_hash = hashlib.sha1(content).hexdigest()
+
+        with open_content_for_writing(temp_repo_dir, content_hash) as f:
+            assert repack_content(temp_repo_dir) == 0
+            f.write(content)
+        assert (temp_repo_dir / content_hash[:2] / content_hash).read_bytes() == content
+
+        assert repack_content(temp_repo_dir) == 1
+        with open_content_for_reading(temp_repo_dir, content_hash) as f:
+            assert f.read() == content
+
+    def test_repack_empty_content(self, temp_repo_dir: Path) -> None:
+        assert repack_content(temp_repo_dir) == 0
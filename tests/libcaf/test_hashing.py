@@ -1,8 +1,11 @@
+import hashlib
+from pathlib import Path
+
 from libcaf.constants import HASH_LENGTH
-from libcaf.plumbing import hash_file, hash_object
-from pytest import raises
+from libcaf.plumbing import hash_file, hash_files, hash_object, hash_string
+from pytest import mark, raises
 
-from libcaf import Blob, Commit, Tree, TreeRecord, TreeRecordType
+from libcaf import Blob, Commit, HashAlgorithm, Tree, TreeRecord, TreeRecordType
 
 
 def test_hash_file_non_existent_file() -> None:
@@ -11,7 +14,8 @@ def test_hash_file_non_existent_file() -> None:
 
 
 def test_commit_hash() -> None:
-    commit = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, '3234567890abcdef')
+    commit = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890,
+                    hash_string('3234567890abcdef'))
     commit_hash = hash_object(commit)
 
     assert commit_hash is not None
@@ -19,7 +23,7 @@ def test_commit_hash() -> None:
 
 
 def test_commit_hash_parent_none() -> None:
-    commit = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, None)
+    commit = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890, None)
     commit_hash = hash_object(commit)
 
     assert commit_hash is not None
@@ -27,8 +31,8 @@ def test_commit_hash_parent_none() -> None:
 
 
 def test_tree_hash() -> None:
-    record1 = TreeRecord(TreeRecordType.TREE, '1234567890abcdef', 'record1')
-    record2 = TreeRecord(TreeRecordType.BLOB, 'abcdef1234567890', 'record2')
+    record1 = TreeRecord(TreeRecordType.TREE, hash_string('1234567890abcdef'), 'record1')
+    record2 = TreeRecord(TreeRecordType.BLOB, hash_string('abcdef1234567890'), 'record2')
 
     tree = Tree({'record1': record1, 'record2': record2})
     tree_hash = hash_object(tree)
@@ -45,22 +49,22 @@ def test_same_blob_objects_get_same_hash() -> None:
 
 
 def test_same_commit_objects_get_same_hash() -> None:
-    commit1 = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, 'aaabb12')
-    commit2 = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, 'aaabb12')
+    commit1 = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890, hash_string('aaabb12'))
+    commit2 = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890, hash_string('aaabb12'))
 
     assert hash_object(commit1) == hash_object(commit2)
 
 
 def test_same_commit_objects_get_same_hash_parent_none() -> None:
-    commit1 = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, None)
-    commit2 = Commit('1234567890abcdef', 'Author', 'Initial commit', 1234567890, None)
+    commit1 = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890, None)
+    commit2 = Commit(hash_string('1234567890abcdef'), 'Author', 'Initial commit', 1234567890, None)
 
     assert hash_object(commit1) == hash_object(commit2)
 
 
 def test_same_tree_objects_get_same_hash() -> None:
-    record1 = TreeRecord(TreeRecordType.TREE, '1234567890abcdef', 'record1')
-    record2 = TreeRecord(TreeRecordType.BLOB, 'abcdef1234567890', 'record2')
+    record1 = TreeRecord(TreeRecordType.TREE, hash_string('1234567890abcdef'), 'record1')
+    record2 = TreeRecord(TreeRecordType.BLOB, hash_string('abcdef1234567890'), 'record2')
 
     tree1 = Tree({'record1': record1, 'record2': record2})
     tree2 = Tree({'record1': record1, 'record2': record2})
@@ -76,9 +80,9 @@ def test_different_hashes_for_different_blobs() -> None:
 
 
 def test_different_hashes_for_different_trees() -> None:
-    record1 = TreeRecord(TreeRecordType.TREE, '1234567890abcdef', 'record1')
-    record2 = TreeRecord(TreeRecordType.BLOB, 'abcdef1234567890', 'record2')
-    record3 = TreeRecord(TreeRecordType.TREE, 'fedcba0987654321', 'record3')
+    record1 = TreeRecord(TreeRecordType.TREE, hash_string('1234567890abcdef'), 'record1')
+    record2 = TreeRecord(TreeRecordType.BLOB, hash_string('abcdef1234567890'), 'record2')
+    record3 = TreeRecord(TreeRecordType.TREE, hash_string('fedcba0987654321'), 'record3')
 
     tree1 = Tree({'record1': record1, 'record2': record2})
     tree2 = Tree({'record1': record1, 'record2': record3})
@@ -87,15 +91,18 @@ def test_different_hashes_for_different_trees() -> None:
 
 
 def test_different_hashes_for_different_commits() -> None:
-    commit1 = Commit('1234567890abcdef', 'Author1', 'Initial commit', 1234567890, None)
-    commit2 = Commit('abcdef1234567890', 'Author2', 'Second commit', 1234567891, '2134567890abcdef')
+    commit1 = Commit(hash_string('1234567890abcdef'), 'Author1', 'Initial commit', 1234567890, None)
+    commit2 = Commit(hash_string('abcdef1234567890'), 'Author2', 'Second commit', 1234567891,
+                     hash_string('2134567890abcdef'))
 
     assert hash_object(commit1) != hash_object(commit2)
 
 
 def test_different_hashes_for_different_parent_commits() -> None:
-    commit1 = Commit('1234567890abcdef', 'Author', 'Commit message', 1234567890, 'parenthash1')
-    commit2 = Commit('1234567890abcdef', 'Author', 'Commit message', 1234567890, 'parenthash2')
+    commit1 = Commit(hash_string('1234567890abcdef'), 'Author', 'Commit message', 1234567890,
+                     hash_string('parenthash1'))
+    commit2 = Commit(hash_string('1234567890abcdef'), 'Author', 'Commit message', 1234567890,
+                     hash_string('parenthash2'))
 
     hash1 = hash_object(commit1)
     hash2 = hash_object(commit2)
@@ -105,8 +112,9 @@ def test_different_hashes_for_different_parent_commits() -> None:
 
 def test_different_hashes_for_different_parent_commits_one_none() -> None:
     # Create two commits that differ only by the parent hash
-    commit1 = Commit('1234567890abcdef', 'Author', 'Commit message', 1234567890, 'parenthash1')
-    commit2 = Commit('1234567890abcdef', 'Author', 'Commit message', 1234567890, None)
+    commit1 = Commit(hash_string('1234567890abcdef'), 'Author', 'Commit message', 1234567890,
+                     hash_string('parenthash1'))
+    commit2 = Commit(hash_string('1234567890abcdef'), 'Author', 'Commit message', 1234567890, None)
 
     # Compute the hash for both commits
     hash1 = hash_object(commit1)
@@ -114,3 +122,42 @@ def test_different_hashes_for_different_parent_commits_one_none() -> None:
 
     # Verify the hashes are different
     assert hash1 != hash2, 'Hashes for commits with different parent hashes one none should not match'
+
+
+@mark.parametrize(('algorithm', 'length'),
+                  [(HashAlgorithm.SHA1, 40), (HashAlgorithm.SHA256, 64), (HashAlgorithm.BLAKE3, 64)])
+def test_hash_length(algorithm: HashAlgorithm, length: int) -> None:
+    assert len(hash_string('abc', algorithm)) == length
+
+
+def test_sha256_hash_string() -> None:
+    assert hash_string('abc', HashAlgorithm.SHA256) == hashlib.sha256(b'abc').hexdigest()
+
+
+@mark.parametrize(('content', 'expected'), [
+    ('', 'af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262'),
+    ('abc', '6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85'),
+])
+def test_blake3_hash_string(content: str, expected: str) -> None:
+    assert hash_string(content, HashAlgorithm.BLAKE3) == expected
+
+
+# Lengths around a single block, several chunks and a tree split over many subtrees
+@mark.parametrize(('length', 'expected'), [
+    (1, '2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213'),
+    (5000, 'ee78d92070de3df1c57c37002abf0a6b1a6589acdeef4d8ffac7cf3d9e8f2836'),
+    (3000001, 'a1ead512edfce7caaecf9c124bb4da104432bfd8ca640e62ab376f1d72a51428'),
+])
+def test_blake3_hash_file(tmp_path: Path, length: int, expected: str) -> None:
+    file_path = tmp_path / 'content.bin'
+    file_path.write_bytes(bytes(i % 251 for i in range(length)))
+
+    assert hash_file(file_path, HashAlgorithm.BLAKE3) == expected
+    assert hash_files([file_path], HashAlgorithm.BLAKE3) == [expected]
+
+
+def test_different_algorithms_give_different_hashes() -> None:
+    record = TreeRecord(TreeRecordType.BLOB, hash_string('abcdef1234567890'), 'record')
+    tree = Tree({'record': record})
+
+    assert len({hash_object(tree, algorithm) for algorithm in HashAlgorithm.__members__.values()}) == 3
@@ -1,12 +1,15 @@
+import struct
 from pathlib import Path
 
-from libcaf.plumbing import hash_object, load_commit, load_tree, save_commit, save_tree
+from libcaf.plumbing import (clear_object_cache, hash_object, hash_string, load_commit, load_tree, object_cache_stats,
+                             repack_content, save_commit, save_tree, set_object_cache_size)
+from pytest import raises
 
-from libcaf import Commit, Tree, TreeRecord, TreeRecordType
+from libcaf import DEFAULT_OBJECT_CACHE_SIZE, Commit, Tree, TreeRecord, TreeRecordType
 
 
 def test_save_load_commit(temp_repo_dir: Path) -> None:
-    commit = Commit('tree_hash123', 'Author', 'Commit message', 1234567890, 'commithash123parent')
+    commit = Commit(hash_string('tree'), 'Author', 'Commit message', 1234567890, hash_string('parent'))
     commit_hash = hash_object(commit)
 
     save_commit(temp_repo_dir, commit)
@@ -20,7 +23,7 @@ def test_save_load_commit(temp_repo_dir: Path) -> None:
 
 
 def test_save_load_commit_without_parent(temp_repo_dir: Path) -> None:
-    commit_none_parent = Commit('commithash456', 'Author', 'Commit message', 1234567890, None)
+    commit_none_parent = Commit(hash_string('tree'), 'Author', 'Commit message', 1234567890, None)
     commit_none_parent_hash = hash_object(commit_none_parent)
 
     save_commit(temp_repo_dir, commit_none_parent)
@@ -35,9 +38,9 @@ def test_save_load_commit_without_parent(temp_repo_dir: Path) -> None:
 
 def test_save_load_tree(temp_repo_dir: Path) -> None:
     records = {
-        'omer': TreeRecord(TreeRecordType.BLOB, 'omer123', 'omer'),
-        'bar': TreeRecord(TreeRecordType.BLOB, 'bar123', 'bar'),
-        'meshi': TreeRecord(TreeRecordType.BLOB, 'meshi123', 'meshi'),
+        'omer': TreeRecord(TreeRecordType.BLOB, hash_string('omer123'), 'omer'),
+        'bar': TreeRecord(TreeRecordType.BLOB, hash_string('bar123'), 'bar'),
+        'meshi': TreeRecord(TreeRecordType.BLOB, hash_string('meshi123'), 'meshi'),
     }
     tree = Tree(records)
     tree_hash = hash_object(tree)
@@ -47,3 +50,135 @@ def test_save_load_tree(temp_repo_dir: Path) -> None:
 
     assert loaded_tree.records.keys() == records.keys()
     assert loaded_tree.records == records
+
+
+def test_load_truncated_tree(temp_repo_dir: Path) -> None:
+    records = {f'file{i}': TreeRecord(TreeRecordType.BLOB, hash_string(f'hash{i}'), f'file{i}') for i in range(100)}
+    tree = Tree(records)
+    tree_hash = hash_object(tree)
+
+    save_tree(temp_repo_dir, tree)
+    saved_file = temp_repo_dir / tree_hash[:2] / tree_hash
+    saved_file.write_bytes(saved_file.read_bytes()[:-3])
+
+    with raises(RuntimeError):
+        load_tree(temp_repo_dir, tree_hash)
+
+
+def _length_prefixed(value: str) -> bytes:
+    return struct.pack('<I', len(value)) + value.encode()
+
+
+def test_save_tree_stores_binary_hashes(temp_repo_dir: Path) -> None:
+    records = {f'file{i}': TreeRecord(TreeRecordType.BLOB, hash_string(f'file{i}'), f'file{i}') for i in range(100)}
+    tree = Tree(records)
+    tree_hash = hash_object(tree)
+
+    save_tree(temp_repo_dir, tree)
+    saved_file = temp_repo_dir / tree_hash[:2] / tree_hash
+
+    saved_content = saved_file.read_bytes()
+    assert saved_content[:7] == b'CAFTREE'
+    assert bytes.fromhex(records['file0'].hash) in saved_content
+    assert records['file0'].hash.encode() not in saved_content
+
+    assert load_tree(temp_repo_dir, tree_hash).records == records
+
+
+def test_save_packed_objects(temp_repo_dir: Path) -> None:
+    tree = Tree({'file': TreeRecord(TreeRecordType.BLOB, hash_string('file'), 'file')})
+    commit = Commit(hash_object(tree), 'Author', 'Commit message', 1234567890, None)
+    save_tree(temp_repo_dir, tree)
+    save_commit(temp_repo_dir, commit)
+    assert repack_content(temp_repo_dir) == 2
+
+    # objects that are already packed aren't written loose again
+    save_tree(temp_repo_dir, tree)
+    save_commit(temp_repo_dir, commit)
+
+    assert [path.name for path in temp_repo_dir.iterdir()] == ['pack']
+    clear_object_cache()
+    assert load_tree(temp_repo_dir, hash_object(tree)).records == tree.records
+    assert load_commit(temp_repo_dir, hash_object(commit)).tree_hash == commit.tree_hash
+
+
+def test_load_legacy_objects(temp_repo_dir: Path) -> None:
+    record = TreeRecord(TreeRecordType.BLOB, hash_string('file'), 'file')
+    tree = Tree({'file': record})
+    tree_hash = hash_object(tree)
+
+    tree_file = temp_repo_dir / tree_hash[:2] / tree_hash
+    tree_file.parent.mkdir()
+    tree_file.write_bytes(struct.pack('<IB', 1, 1) + _length_prefixed(record.hash) + _length_prefixed(record.name))
+
+    commit = Commit(tree_hash, 'Author', 'Commit message', 1234567890, None)
+    commit_hash = hash_object(commit)
+
+    commit_file = temp_repo_dir / commit_hash[:2] / commit_hash
+    commit_file.parent.mkdir(exist_ok=True)
+    commit_file.write_bytes(_length_prefixed(tree_hash) + _length_prefixed(commit.author) +
+                            _length_prefixed(commit.message) + struct.pack('<Q', commit.timestamp) +
+                            _length_prefixed(''))
+
+    assert load_tree(temp_repo_dir, tree_hash).records == {'file': record}
+
+    loaded_commit = load_commit(temp_repo_dir, commit_hash)
+    assert loaded_commit.tree_hash == tree_hash
+    assert loaded_commit.timestamp == commit.timestamp
+    assert loaded_commit.parent is None
+
+
+def test_save_over_legacy_object(temp_repo_dir: Path) -> None:
+    record = TreeRecord(TreeRecordType.BLOB, hash_string('file'), 'file')
+    tree = Tree({'file': record})
+    tree_hash = hash_object(tree)
+
+    tree_file = temp_repo_dir / tree_hash[:2] / tree_hash
+    tree_file.parent.mkdir()
+    tree_file.write_bytes(struct.pack('<IB', 1, 1) + _length_prefixed(record.hash) + _length_prefixed(record.name))
+    legacy_size = tree_file.stat().st_size
+
+    # the tagged layout is shorter, no tail of the legacy object may be left behind
+    save_tree(temp_repo_dir, tree)
+    assert tree_file.read_bytes()[:7] == b'CAFTREE'
+    assert tree_file.stat().st_size < legacy_size
+
+    clear_object_cache()
+    assert load_tree(temp_repo_dir, tree_hash).records == {'file': record}
+
+
+def test_load_tree_is_cached(temp_repo_dir: Path) -> None:
+    tree = Tree({'file': TreeRecord(TreeRecordType.BLOB, hash_string('file'), 'file')})
+    tree_hash = hash_object(tree)
+    save_tree(temp_repo_dir, tree)
+
+    clear_object_cache()
+    first = load_tree(temp_repo_dir, tree_hash)
+    second = load_tree(temp_repo_dir, tree_hash)
+
+    assert first is second
+    stats = object_cache_stats()
+    assert (stats.trees.hits, stats.trees.misses, stats.trees.size) == (1, 1, 1)
+    assert (stats.commits.hits, stats.commits.misses, stats.commits.size) == (0, 0, 0)
+
+
+def test_object_cache_size(temp_repo_dir: Path) -> None:
+    commits = [Commit(hash_string('tree'), 'Author', 'Commit message', timestamp, None) for timestamp in range(5)]
+    for commit in commits:
+        save_commit(temp_repo_dir, commit)
+
+    clear_object_cache()
+    set_object_cache_size(2)
+    try:
+        for commit in commits:
+            load_commit(temp_repo_dir, hash_object(commit))
+        stats = object_cache_stats()
+        assert (stats.commits.size, stats.commits.capacity) == (2, 2)
+        assert stats.trees.capacity == 2
+
+        load_commit(temp_repo_dir, hash_object(commits[0]))
+        assert object_cache_stats().commits.hits == 0
+        load_commit(temp_repo_dir, hash_object(commits[0]))
+        assert object_cache_stats().commits.hits == 1
+    finally:
+        set_object_cache_size(DEFAULT_OBJECT_CACHE_SIZE)
@@ -1,4 +1,5 @@
-from libcaf import Tree, TreeRecord, TreeRecordType
+from libcaf import Commit, Tree, TreeRecord, TreeRecordType
+from pytest import mark, raises
 
 
 def test_tree_entries_are_canonicalized() -> None:
@@ -28,3 +29,15 @@ def test_tree_entries_are_canonicalized() -> None:
 
     # This test should fail currently because Tree doesn't canonicalize entries
     assert tree1_keys == tree2_keys == tree3_keys == expected_keys, 'Tree entries are not properly canonicalized'
+
+
+@mark.parametrize('invalid_hash', ['', 'omer123', '1234567890abcdef', 'A' * 40])
+def test_objects_reject_invalid_hashes(invalid_hash: str) -> None:
+    valid_hash = '1' * 40
+
+    with raises(ValueError):
+        TreeRecord(TreeRecordType.BLOB, invalid_hash, 'file')
+    with raises(ValueError):
+        Commit(invalid_hash, 'Author', 'Commit message', 1234567890, None)
+    with raises(ValueError):
+        Commit(valid_hash, 'Author', 'Commit message', 1234567890, invalid_hash)
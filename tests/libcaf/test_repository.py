@@ -2,10 +2,12 @@ from pathlib import Path
 from shutil import rmtree
 
 from libcaf.constants import DEFAULT_BRANCH, HASH_LENGTH
-from libcaf.plumbing import hash_object, load_commit, load_tree
+from libcaf.plumbing import hash_object, hash_string, load_commit, load_tree
 from libcaf.ref import RefError, SymRef
 from libcaf.repository import HashRef, Repository, RepositoryError, branch_ref
-from pytest import raises
+from pytest import mark, raises
+
+from libcaf import HashAlgorithm, Tree, TreeRecord, TreeRecordType
 
 
 def test_init_with_custom_repo_dir(temp_repo_dir: Path) -> None:
@@ -20,6 +22,47 @@ def test_init_with_custom_repo_dir(temp_repo_dir: Path) -> None:
     assert (temp_repo_dir / custom_repo_dir).exists()
 
 
+def test_compressed_repository(temp_repo_dir: Path) -> None:
+    repo = Repository(temp_repo_dir)
+    repo.init(compress_objects=True)
+    assert repo.compress_objects()
+
+    temp_file = temp_repo_dir / 'test_file.txt'
+    temp_file.write_text('aaaaaaaaaabbbbbccd' * 1000)
+
+    blob = repo.save_file_content(temp_file)
+    saved_file = repo.objects_dir() / blob.hash[:2] / blob.hash
+
+    assert saved_file.stat().st_size < temp_file.stat().st_size
+    assert repo.read_file_content(blob.hash) == temp_file.read_bytes()
+
+
+def test_uncompressed_repository_by_default(temp_repo: Repository) -> None:
+    assert not temp_repo.compress_objects()
+
+
+def test_sha1_repository_by_default(temp_repo: Repository) -> None:
+    assert temp_repo.hash_algorithm() == HashAlgorithm.SHA1
+
+
+@mark.parametrize('algorithm', [HashAlgorithm.SHA256, HashAlgorithm.BLAKE3])
+def test_commit_with_hash_algorithm(temp_repo_dir: Path, algorithm: HashAlgorithm) -> None:
+    repo = Repository(temp_repo_dir)
+    repo.init(hash_algorithm=algorithm)
+    assert repo.hash_algorithm() == algorithm
+
+    temp_file = temp_repo_dir / 'test_file.txt'
+    temp_file.write_text('This is a test file for commit.')
+
+    commit_ref = repo.commit_working_dir('John Doe', 'Initial commit')
+    hash_length = len(hash_string('', algorithm))
+    assert len(commit_ref) == hash_length
+    assert repo.resolve_ref(commit_ref) == commit_ref
+
+    commit = load_commit(repo.objects_dir(), commit_ref)
+    assert len(commit.tree_hash) == hash_length
+
+
 def test_commit(temp_repo: Repository) -> None:
     temp_file = temp_repo.working_dir / 'test_file.txt'
     temp_file.write_text('This is a test file for commit.')
@@ -44,6 +87,26 @@ def test_commit(temp_repo: Repository) -> None:
     assert commit_object.exists()
 
 
+def test_repack(temp_repo: Repository) -> None:
+    temp_file = temp_repo.working_dir / 'test_file.txt'
+    temp_file.write_text('First content')
+    first_commit_ref = temp_repo.commit_working_dir('John Doe', 'First commit')
+
+    temp_file.write_text('Second content')
+    second_commit_ref = temp_repo.commit_working_dir('John Doe', 'Second commit')
+
+    # two blobs, two trees and two commits
+    assert temp_repo.repack() == 6
+    assert not (temp_repo.objects_dir() / second_commit_ref[:2] / second_commit_ref).exists()
+
+    assert [entry.commit_ref for entry in temp_repo.log()] == [second_commit_ref, first_commit_ref]
+    assert len(temp_repo.diff_commits(first_commit_ref, second_commit_ref)) == 1
+
+    temp_file.write_text('Third content')
+    third_commit_ref = temp_repo.commit_working_dir('John Doe', 'Third commit')
+    assert load_commit(temp_repo.objects_dir(), third_commit_ref).parent == second_commit_ref
+
+
 def test_commit_with_parent(temp_repo: Repository) -> None:
     objects_dir = temp_repo.objects_dir()
 
@@ -178,6 +241,34 @@ def test_add_branch_already_exists_raises_error(temp_repo: Repository) -> None:
         temp_repo.add_branch(DEFAULT_BRANCH)
 
 
+def test_save_dir_builds_nested_trees(temp_repo: Repository) -> None:
+    test_dir = temp_repo.working_dir / 'test_dir'
+    deep_dir = test_dir / 'a' / 'b'
+    deep_dir.mkdir(parents=True)
+    (test_dir / 'empty').mkdir()
+    (deep_dir / temp_repo.repo_dir.name).mkdir()
+    (deep_dir / temp_repo.repo_dir.name / 'ignored.txt').write_text('Ignored')
+    (deep_dir / 'file.txt').write_text('Deep content')
+    (test_dir / 'top.txt').write_text('Top content')
+
+    tree_ref = temp_repo.save_dir(test_dir)
+
+    objects_dir = temp_repo.objects_dir()
+    file_hash = hash_string('Deep content')
+    b_tree = Tree({'file.txt': TreeRecord(TreeRecordType.BLOB, file_hash, 'file.txt')})
+    a_tree = Tree({'b': TreeRecord(TreeRecordType.TREE, hash_object(b_tree), 'b')})
+    empty_tree = Tree({})
+    root_tree = Tree({'a': TreeRecord(TreeRecordType.TREE, hash_object(a_tree), 'a'),
+                      'empty': TreeRecord(TreeRecordType.TREE, hash_object(empty_tree), 'empty'),
+                      'top.txt': TreeRecord(TreeRecordType.BLOB, hash_string('Top content'), 'top.txt')})
+
+    assert tree_ref == hash_object(root_tree)
+    assert set(load_tree(objects_dir, tree_ref).records) == {'a', 'empty', 'top.txt'}
+    assert set(load_tree(objects_dir, hash_object(b_tree)).records) == {'file.txt'}
+    assert (objects_dir / file_hash[:2] / file_hash).exists()
+    assert not (objects_dir / hash_string('Ignored')[:2] / hash_string('Ignored')).exists()
+
+
 def test_save_dir_invalid_path_raises_error(temp_repo: Repository) -> None:
     with raises(NotADirectoryError):
         temp_repo.save_dir(None)